@@ -1,9 +1,5 @@
 module;
 
-#include <godot_cpp/variant/vector2.hpp>
-#include <godot_cpp/variant/vector3.hpp>
-#include <godot_cpp/classes/texture2d.hpp>
-
 #include <includes.hpp>
 #include <functional>
 
@@ -16,9 +12,6 @@ import misc.list;
 import misc.number;
 import misc.pos;
 import game.core;
-import game.texture.asset_loader;
-
-using namespace godot;
 
 export namespace craftbuild {
     constexpr uint8 FACE_LEN = 6;
@@ -32,6 +25,13 @@ export namespace craftbuild {
         BACK
     };
 
+    // Faces a block's texture has, side by side in its image
+    enum class FaceCount : uint8 {
+        ONE = 1,
+        THREE = 3,
+        SIX = 6
+    };
+
     struct TagEntry {
         Str name;
         List<uint64> value;
@@ -93,43 +93,45 @@ export namespace craftbuild {
 
 		virtual std::vector<std::pair<Str, size>> init_tags() { return {}; }
 
-        static none create_face(Face face, const Vector3& pos, List<Pos<real>>& vertices) {
+        static none create_face(Face face, const Pos<real>& pos, List<Pos<real>>& vertices) {
+            auto corner = [&](real x, real y, real z) { vertices.append(Pos<real>(pos.x + x, pos.y + y, pos.z + z)); };
+
             switch (face) {
             case Face::TOP: // +Y
-                vertices.append(pos + Vector3(1, 1, 0));
-                vertices.append(pos + Vector3(0, 1, 0));
-                vertices.append(pos + Vector3(0, 1, 1));
-                vertices.append(pos + Vector3(1, 1, 1));
+                corner(1, 1, 0);
+                corner(0, 1, 0);
+                corner(0, 1, 1);
+                corner(1, 1, 1);
                 break;
             case Face::BOTTOM: // -Y
-                vertices.append(pos + Vector3(1, 0, 1));
-                vertices.append(pos + Vector3(0, 0, 1));
-                vertices.append(pos + Vector3(0, 0, 0));
-                vertices.append(pos + Vector3(1, 0, 0));
+                corner(1, 0, 1);
+                corner(0, 0, 1);
+                corner(0, 0, 0);
+                corner(1, 0, 0);
                 break;
             case Face::RIGHT: // +X
-                vertices.append(pos + Vector3(1, 1, 0));
-                vertices.append(pos + Vector3(1, 1, 1));
-                vertices.append(pos + Vector3(1, 0, 1));
-                vertices.append(pos + Vector3(1, 0, 0));
+                corner(1, 1, 0);
+                corner(1, 1, 1);
+                corner(1, 0, 1);
+                corner(1, 0, 0);
                 break;
             case Face::LEFT: // -X
-                vertices.append(pos + Vector3(0, 1, 1));
-                vertices.append(pos + Vector3(0, 1, 0));
-                vertices.append(pos + Vector3(0, 0, 0));
-                vertices.append(pos + Vector3(0, 0, 1));
+                corner(0, 1, 1);
+                corner(0, 1, 0);
+                corner(0, 0, 0);
+                corner(0, 0, 1);
                 break;
             case Face::FRONT: // +Z
-                vertices.append(pos + Vector3(1, 1, 1));
-                vertices.append(pos + Vector3(0, 1, 1));
-                vertices.append(pos + Vector3(0, 0, 1));
-                vertices.append(pos + Vector3(1, 0, 1));
+                corner(1, 1, 1);
+                corner(0, 1, 1);
+                corner(0, 0, 1);
+                corner(1, 0, 1);
                 break;
             case Face::BACK: // -Z
-                vertices.append(pos + Vector3(0, 1, 0));
-                vertices.append(pos + Vector3(1, 1, 0));
-                vertices.append(pos + Vector3(1, 0, 0));
-                vertices.append(pos + Vector3(0, 0, 0));
+                corner(0, 1, 0);
+                corner(1, 1, 0);
+                corner(1, 0, 0);
+                corner(0, 0, 0);
                 break;
             }
         }
@@ -166,12 +168,14 @@ export namespace craftbuild {
         }
     };
 
+    // The texture is only named here; AtlasTexture loads it on the engine side
     struct BlockEntry {
         Ptr<Block> block;
         Str name;
-        Ref<Texture2D> texture;
+        Str texture;
+        FaceCount face_count;
 
-        BlockEntry(Ptr<Block> b, const Str& n, Ref<Texture2D> t) : block(b), name(n), texture(t) {}
+        BlockEntry(Ptr<Block> b, const Str& n, const Str& t, FaceCount f) : block(b), name(n), texture(t), face_count(f) {}
     };
 
     struct BlockRegistry {
@@ -182,26 +186,20 @@ export namespace craftbuild {
         requires std::derived_from<T, Block>
         static none register_block(const Str& name, const char* path) {
             Ptr<Block> block = new T();
-            Ref<Texture2D> texture;
-            if (dynamic_cast<Block1F*>(block.c_ptr())) {
-                texture = AssetLoader::load_block_texture(registry.size(), path, FaceCount::ONE);
-            }
-            else if (dynamic_cast<Block3F*>(block.c_ptr())) {
-                texture = AssetLoader::load_block_texture(registry.size(), path, FaceCount::THREE);
-            }
-            else if (dynamic_cast<Block6F*>(block.c_ptr())) {
-                texture = AssetLoader::load_block_texture(registry.size(), path, FaceCount::SIX);
-            }
+            FaceCount face_count = FaceCount::ONE;
+            if (dynamic_cast<Block3F*>(block.c_ptr()))      face_count = FaceCount::THREE;
+            else if (dynamic_cast<Block6F*>(block.c_ptr())) face_count = FaceCount::SIX;
 			for (const auto& pair : block.value().init_tags()) {
 				TagRegistry::set_value(TagRegistry::get_id(pair.first), pair.second, 0);
 			}
-            registry.emplace_back(block, name, texture);
+            registry.emplace_back(block, name, path, face_count);
             name2id[name] = registry.size() - 1;
         }
 
-        static Ptr<Block> get_block(uint32 block_id) {
-            if (registry.size() <= block_id) return registry[get_id("Air")].block;
-            return registry[block_id].block;
+        // Blocks are never unregistered, so the view stays valid
+        static View<Block> get_block(uint32 block_id) {
+            if (registry.size() <= block_id) return registry[get_id("Air")].block.c_ptr();
+            return registry[block_id].block.c_ptr();
         }
 
         static Str get_name(uint32 block_id) {
@@ -156,4 +156,145 @@ namespace craftbuild {
         log<LogType::INFO>(output);
         return output;
     }
-}
\ No newline at end of file
+
+    // memory                 : chunk memory usage and region files
+    // memory budget <MB>     : changes the chunk memory budget
+    Str CommandInterpreter::execute_memory(const std::vector<Str>& args) {
+        Main* world = static_cast<Main*>(world_ptr);
+        if (not world) return "";
+        Str output;
+
+        if (args.size() < 2) {
+            output = world->memory_report();
+            log<LogType::INFO>(output);
+            return output;
+        }
+
+        if (args[1] != "budget" or args.size() < 3) {
+            output = "Usage: memory [budget <MB>]";
+            log<LogType::ERROR>(output);
+            return output;
+        }
+
+        try {
+            int64 mb = std::stoll(args[2].std_str());
+            if (mb <= 0) {
+                output = "Budget must be positive";
+                log<LogType::ERROR>(output);
+                return output;
+            }
+
+            world->set_memory_budget(static_cast<size>(mb));
+            output = format{} << "Chunk memory budget set to " << mb << " MB";
+            log<LogType::INFO>(output);
+        }
+        catch (const std::exception& e) {
+            output = "Invalid command arguments";
+            log<LogType::ERROR>(output);
+        }
+        return output;
+    }
+
+    // forceload                       : lists every ticket
+    // forceload add <cx> <cz> [level] : keeps the chunks within level of (cx, cz) loaded, 0 by default
+    // forceload remove <cx> <cz>
+    Str CommandInterpreter::execute_forceload(const std::vector<Str>& args) {
+        Main* world = static_cast<Main*>(world_ptr);
+        if (not world) return "";
+        Str output;
+
+        if (args.size() < 2) {
+            output = world->ticket_report();
+            log<LogType::INFO>(output);
+            return output;
+        }
+
+        if ((args[1] != "add" and args[1] != "remove") or args.size() < 4) {
+            output = "Usage: forceload [add <cx> <cz> [level] | remove <cx> <cz>]";
+            log<LogType::ERROR>(output);
+            return output;
+        }
+
+        try {
+            int32 cx = std::stoi(args[2].std_str());
+            int32 cz = std::stoi(args[3].std_str());
+            int32 level = args.size() >= 5 ? std::stoi(args[4].std_str()) : 0;
+            const Pos<int> chunk_pos(cx, 0, cz);
+
+            if (args[1] == "add") {
+                if (level < 0 or level > Main::render_distance) {
+                    output = format{} << "Level must be between 0 and " << Main::render_distance;
+                    log<LogType::ERROR>(output);
+                    return output;
+                }
+                if (not world->add_forced_ticket(chunk_pos, level)) {
+                    output = format{} << "Chunk (" << cx << "," << cz << ") is already forced";
+                    log<LogType::ERROR>(output);
+                    return output;
+                }
+                output = format{} << "Forced chunks within " << level << " of (" << cx << "," << cz << ")";
+            }
+            else {
+                if (not world->remove_forced_ticket(chunk_pos)) {
+                    output = format{} << "Chunk (" << cx << "," << cz << ") is not forced";
+                    log<LogType::ERROR>(output);
+                    return output;
+                }
+                output = format{} << "Released chunk (" << cx << "," << cz << ")";
+            }
+            log<LogType::INFO>(output);
+        }
+        catch (const std::exception& e) {
+            output = "Invalid command arguments";
+            log<LogType::ERROR>(output);
+        }
+        return output;
+    }
+
+    // save                     : saves in the background
+    // save status              : the last save and the autosave interval
+    // save autosave <minutes>  : 0 turns autosave off
+    Str CommandInterpreter::execute_save(const std::vector<Str>& args) {
+        Main* world = static_cast<Main*>(world_ptr);
+        if (not world) return "";
+        Str output;
+
+        if (args.size() < 2) {
+            world->save_world(world->save_path());
+            output = "Saving world in the background";
+            log<LogType::INFO>(output);
+            return output;
+        }
+
+        if (args[1] == "status") {
+            output = world->save_report();
+            log<LogType::INFO>(output);
+            return output;
+        }
+
+        if (args[1] != "autosave" or args.size() < 3) {
+            output = "Usage: save [status | autosave <minutes>]";
+            log<LogType::ERROR>(output);
+            return output;
+        }
+
+        try {
+            int64 minutes = std::stoll(args[2].std_str());
+            if (minutes < 0) {
+                output = "Interval cannot be negative";
+                log<LogType::ERROR>(output);
+                return output;
+            }
+
+            world->set_autosave_interval(static_cast<int32>(minutes));
+            if (minutes == 0) output = "Autosave turned off";
+            else output = format{} << "Autosaving every " << minutes << " minutes";
+            log<LogType::INFO>(output);
+        }
+        catch (const std::exception& e) {
+            output = "Invalid command arguments";
+            log<LogType::ERROR>(output);
+        }
+        return output;
+    }
+}
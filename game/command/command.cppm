@@ -90,6 +90,9 @@ export namespace craftbuild {
             if (parts[0] == "set_block") return execute_set_block(parts);
             else if (parts[0] == "fill") return execute_fill(parts);
             else if (parts[0] == "give") return execute_give(parts);
+            else if (parts[0] == "memory") return execute_memory(parts);
+            else if (parts[0] == "forceload") return execute_forceload(parts);
+            else if (parts[0] == "save") return execute_save(parts);
             else {
                 Str output = format{} << "Invalid command: " << parts[0];
                 log<LogType::ERROR>(output);
@@ -100,5 +103,8 @@ export namespace craftbuild {
         Str execute_set_block(const std::vector<Str>& args);
         Str execute_fill(const std::vector<Str>& args);
         Str execute_give(const std::vector<Str>& args);
+        Str execute_memory(const std::vector<Str>& args);
+        Str execute_forceload(const std::vector<Str>& args);
+        Str execute_save(const std::vector<Str>& args);
     };
 }
\ No newline at end of file
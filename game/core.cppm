@@ -1,15 +1,11 @@
 module;
 
-#include <godot_cpp/classes/wrapped.hpp>
-
 #include <includes.hpp>
 #include <concepts>
 #define VERSION "26.4"
 
 export module game.core;
 
-using namespace godot;
-
 export namespace craftbuild {
     inline constexpr const char* version = VERSION;
     inline constexpr const char* full_version = "indev " VERSION;
@@ -1,14 +1,13 @@
 module;
 
-#include <godot_cpp/variant/string.hpp>
-#include <godot_cpp/classes/project_settings.hpp>
-
 #include <includes.hpp>
 #include <mutex>
 #include <thread>
 #include <string>
+#include <cstdio>
 #include <fstream>
 #include <filesystem>
+#include <functional>
 
 export module game.logger;
 
@@ -18,8 +17,6 @@ import misc.format;
 import game.core;
 import game.thread;
 
-using namespace godot;
-
 namespace craftbuild {
     auto get_time = []() {
         auto now = std::chrono::system_clock::now();
@@ -43,8 +40,12 @@ export namespace craftbuild {
         inline static Str file_queue;
         inline static std::mutex log_mutex;
 
+        // Set before the first log: the game prints through the engine and writes under user://
+        inline static std::function<none(const Str&)> console = [](const Str& log) { std::puts(log.std_str().c_str()); };
+        inline static std::filesystem::path directory;     // No log file while empty
+
         static none store(const Str& log, const Str& file_log) {
-            if (craftbuild_debug) UtilityFunctions::print(log.std_str().c_str());
+            if (craftbuild_debug) console(log);
 
             std::lock_guard<std::mutex> lock(log_mutex);
             file_queue += file_log + "\n";
@@ -58,14 +59,12 @@ export namespace craftbuild {
                 file_dump.swap(file_queue);
             }
 
-            if (not file_dump) return;
+            if (not file_dump or directory.empty()) return;
 
             static auto log_file = []() {
                 const auto time = get_time();
-                const String real_path = ProjectSettings::get_singleton()->globalize_path(("user://game/logs/" + time2file_name(time) + ".txt").std_str().c_str());
-                const std::string std_path = real_path.utf8().get_data();
-                std::filesystem::create_directories(std::filesystem::path(std_path).parent_path());
-                return std::ofstream(std_path);
+                std::filesystem::create_directories(directory);
+                return std::ofstream(directory / (time2file_name(time) + ".txt").std_str());
             }();
 
             log_file << file_dump << std::flush;
@@ -13,6 +13,7 @@ module;
 #include <godot_cpp/classes/standard_material3d.hpp>
 #include <godot_cpp/classes/concave_polygon_shape3d.hpp>
 #include <godot_cpp/variant/node_path.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
 
 #include <includes.hpp>
 #include <cmath>
@@ -21,7 +22,9 @@ module;
 #include <random>
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <shared_mutex>
 
@@ -29,50 +32,23 @@ module game.main;
 
 import game.player;
 import game.command;
+import game.world.save;
+import game.world.content;
 
 namespace craftbuild {
     none Main::_ready() {
         start_log_thread();
 
-        TagRegistry::register_tag("face");
-        TagRegistry::register_tag("transparent");
-
-        BlockRegistry::register_block<Air>          ("Air",           "");
-        BlockRegistry::register_block<Grass>        ("Grass Block",   "grass_block.png");
-        BlockRegistry::register_block<Dirt>         ("Dirt",          "dirt.png");
-        BlockRegistry::register_block<Stone>        ("Stone",         "stone.png");
-        BlockRegistry::register_block<OakPlanks>    ("Oak Planks",    "oak_planks.png");
-        BlockRegistry::register_block<DiamondBlock> ("Diamond Block", "diamond_block.png");
-        BlockRegistry::register_block<DiamondOre>   ("Diamond Ore",   "diamond_ore.png");
-        BlockRegistry::register_block<Bedrock>      ("Bedrock",       "bedrock.png");
-
-        Biome plains;
-        plains.base_height = 5.0f;
-        plains.base_noise = 0.1f;
-        plains.detail_height = 4.0f;
-        plains.detail_noise = 0.2f;
-        plains.min_height = 40;
-
-        Biome normal;
-        normal.base_height = 60.0f;
-        normal.base_noise = 0.05f;
-        normal.detail_height = 8.0f;
-        normal.detail_noise = 0.5f;
-        normal.min_height = 40;
-
-        Biome mountains;
-        mountains.base_height = 140.0f;
-        mountains.base_noise = 0.02f;
-        mountains.detail_height = 35.0f;
-        mountains.detail_noise = 0.15f;
-        mountains.min_height = 40;
-
-        BiomeRegistry::register_biome("Plains", plains);
-        BiomeRegistry::register_biome("Normal", normal);
-        BiomeRegistry::register_biome("Mountains", mountains);
+        register_world_content();
 
         if (not load_userdata()) log<LogType::WARNING>("Userdata file not found.");
-        if (not load_world(format{} << "user://game/saves/" << world_name << "/overworld.cbsave")) {
+
+        // load_world() restores the player's position into it
+        player_ptr = get_node<Player>("Player");
+
+        const String region_path = ProjectSettings::get_singleton()->globalize_path((format{} << "user://game/saves/" << world_name << "/region").std_str().c_str());
+        regions.open(region_path.utf8().get_data());
+        if (not load_world(save_path())) {
             log<LogType::WARNING>("Save file not found, starting new world.");
             if (world_seed.load(std::memory_order_acquire) == 0) {
                 std::mt19937 generator;
@@ -80,22 +56,19 @@ namespace craftbuild {
                 world_seed.store(distribution(generator), std::memory_order_release);
             }
         }
-        noise.instantiate();
-        noise->set_noise_type(FastNoiseLite::TYPE_SIMPLEX);
-        noise->set_frequency(0.0125f);
-        noise->set_seed(world_seed.load(std::memory_order_acquire));
+        noise.set_frequency(WORLD_NOISE_FREQUENCY);
+        noise.set_seed(world_seed.load(std::memory_order_acquire));
 
         AtlasTexture::build_texture_array();
         setup_voxel_material();
 
-        player_ptr = get_node<Player>("Player");
-
         log<LogType::VERBOSE>("Assets loaded");
 
         command_ptr = new CommandInterpreter(this);
 
         world_ready.store(true, std::memory_order_release);
         start_redstone_thread();
+        saves.set_on_written([this]() { scheduler.wake(); });
         start_scheduler_thread();
 
         log<LogType::INFO>("Main initialized");
@@ -110,36 +83,67 @@ namespace craftbuild {
         player_y.store(player_pos.y, std::memory_order_relaxed);
         player_z.store(player_pos.z, std::memory_order_relaxed);
 
+        const Vector3 forward = -player->get_global_transform().basis.get_column(2);
+        view_x.store(forward.x, std::memory_order_relaxed);
+        view_z.store(forward.z, std::memory_order_relaxed);
+
+        const Vector3 velocity = player->get_velocity();
+        const float32 chunk_vx = velocity.x / Chunk::SIZE_X;
+        const float32 chunk_vz = velocity.z / Chunk::SIZE_Z;
+        velocity_x.store(chunk_vx, std::memory_order_relaxed);
+        velocity_z.store(chunk_vz, std::memory_order_relaxed);
+
+        // Crossing a chunk border, turning by more than a view sector or changing the lead reorders the scheduler
+        const Pos<int> player_chunk((int)std::floor(player_pos.x / Chunk::SIZE_X), 0, (int)std::floor(player_pos.z / Chunk::SIZE_Z));
+        const Vector3 view = Vector3(forward.x, 0, forward.z).normalized();
+        const Pos<int> lead = ChunkScheduler::lead_for(chunk_vx, chunk_vz);
+        if (player_chunk != woken_chunk or view.dot(woken_view) < 0.92f or lead != woken_lead) {
+            woken_chunk = player_chunk;
+            woken_view = view;
+            woken_lead = lead;
+            scheduler.wake();
+        }
+
         if (not world_ready.load(std::memory_order_acquire)) return;
 
-        std::vector<Ptr<Chunk>> chunks_to_upload;
-        {
-            std::shared_lock lock(chunks_mutex);
-            for (const auto& E : chunks) {
-                if (E.second.value().mesh_ready.load(std::memory_order_acquire)) {
-                    chunks_to_upload.push_back(E.second);
-                }
-            }
+        // Skipped while the previous save is still being written; it is retried next frame
+        const int32 autosave = autosave_minutes.load(std::memory_order_relaxed);
+        autosave_timer += delta;
+        if (autosave > 0 and autosave_timer >= autosave * 60.0 and not saves.busy()) {
+            autosave_timer = 0;
+            save_world(save_path());
         }
 
+        std::vector<IPtr<Chunk>> chunks_to_upload;
+        chunks.for_each([&](const Pos<int32>& pos, const IPtr<Chunk>& chunk) {
+            if (chunk.value().get_state().has(ChunkState::MESH_READY)) chunks_to_upload.push_back(chunk);
+        });
+
         static const int max_updates = 4;
         int updates_this_frame = 0;
 
         for (auto& chunk_ptr : chunks_to_upload) {
             if (updates_this_frame >= max_updates) break;
 
-            Ptr<MeshData> data = nullptr;
+            IPtr<MeshData> data = nullptr;
             {
                 std::lock_guard lock(chunk_ptr.value().mesh_mutex);
                 if (chunk_ptr.value().pending_mesh_data) {
                     data = chunk_ptr.value().pending_mesh_data;
 					chunk_ptr.value().pending_mesh_data.clear();
-                    chunk_ptr.value().mesh_ready.store(false, std::memory_order_release);
                 }
+                chunk_ptr.value().set_flag(ChunkState::MESH_READY, false);
             }
 
             if (not data) continue;
 
+            const auto& mesh_data = data.value();
+            chunk_ptr.value().mesh_bytes.store(
+                len(mesh_data.vertices) * sizeof(Pos<float32>) * 2 + len(mesh_data.indices) * sizeof(int32) + len(mesh_data.uvs) * sizeof(UV) * 2,
+                std::memory_order_relaxed);
+            // The faces plus the physics server's BVH over them, roughly
+            chunk_ptr.value().collision_bytes.store(len(mesh_data.collision_faces) * sizeof(Pos<float32>) * 2, std::memory_order_relaxed);
+
             Ref<ArrayMesh> mesh;
             mesh.instantiate();
 
@@ -159,13 +163,14 @@ namespace craftbuild {
                 indices.resize(len(data.value().indices));
                 memcpy(indices.ptrw(), data.value().indices.c_ptr(), len(data.value().indices) * sizeof(int32));
 
+                static_assert(sizeof(UV) == sizeof(Vector2));
                 PackedVector2Array uvs;
                 uvs.resize(len(data.value().uvs));
-                memcpy(uvs.ptrw(), data.value().uvs.c_ptr(), len(data.value().uvs) * sizeof(Vector2));
+                memcpy(uvs.ptrw(), data.value().uvs.c_ptr(), len(data.value().uvs) * sizeof(UV));
 
                 PackedVector2Array uvs_layer;
                 uvs_layer.resize(len(data.value().uvs_layer));
-                memcpy(uvs_layer.ptrw(), data.value().uvs_layer.c_ptr(), len(data.value().uvs_layer) * sizeof(Vector2));
+                memcpy(uvs_layer.ptrw(), data.value().uvs_layer.c_ptr(), len(data.value().uvs_layer) * sizeof(UV));
 
                 PackedVector3Array collision_faces;
                 collision_faces.resize(len(data.value().collision_faces));
@@ -181,12 +186,12 @@ namespace craftbuild {
                 update_chunk_mesh(chunk_ptr, mesh, collision_faces);
             }
 
-            chunk_ptr.value().collision_built.store(false, std::memory_order_release);
+            chunk_ptr.value().set_flag(ChunkState::COLLISION_BUILT, false);
 
             updates_this_frame++;
         }
 
-        List<Pos<int>> pending_unloads;
+        List<PendingUnload> pending_unloads;
 
         if (not should_remove_chunks.load(std::memory_order_acquire)) return;
 
@@ -200,28 +205,56 @@ namespace craftbuild {
             should_remove_chunks.store(false, std::memory_order_release);
         }
 
-        std::unique_lock lock(chunks_mutex);
-        for (const auto& pos : pending_unloads) {
-            if (not chunks.contains(pos)) continue;
+        for (const auto& unload : pending_unloads) {
+            // Under the pending-writes lock, so a neighbour's structure either lands before the revision check or
+            // finds the chunk gone and waits in the queue for its next terrain job
+            bool changed = false;
+            auto chunk_ptr = pending_writes.exclusive([&]() -> IPtr<Chunk> {
+                auto chunk = get_chunk(unload.pos.x, unload.pos.z);
+                if (not chunk) return nullptr;
+                if (chunk.value().get_state().revision() != unload.revision) {
+                    chunk.value().set_flag(ChunkState::UNLOADING, false);
+                    changed = true;
+                    return nullptr;
+                }
+                return chunks.erase(unload.pos);
+            });
+
+            // Changed since it was queued (a neighbour's structure landed in it); it stays for now, its queued write
+            // stores the newer content, and the scheduler unloads it again unless a ticket took it back meanwhile
+            if (changed) {
+                {
+                    std::lock_guard lock(rejected_unloads_mutex);
+                    rejected_unloads.push_back(unload.pos);
+                }
+                scheduler.request(unload.pos);
+                scheduler.wake();
+                continue;
+            }
+            if (not chunk_ptr) continue;
+
+            chunk_ptr.value().cancel_jobs();
+            chunk_nodes.remove(chunk_ptr.value().chunk_pos);
 
-            auto chunk_ptr = chunks[pos];
-            if (chunk_ptr.value().mesh_instance) chunk_ptr.value().mesh_instance->queue_free();
-            chunks.erase(pos);
+            // The player may have come back during the write; the scheduler skipped it while it was unloading
+            scheduler.request(unload.pos);
         }
+        Reclaimer::collect();
     }
 
     none Main::_notification(int p_what) {
-        Str file_name = format{} << "user://game/saves/" << world_name << "/overworld.cbsave";
-        if (p_what == NOTIFICATION_WM_CLOSE_REQUEST) save_world(file_name); // Auto save
+        // Started on close so most of it is written by the time the tree exits; that save only adds what changed since
+        if (p_what == NOTIFICATION_WM_CLOSE_REQUEST) save_world(save_path());
         else if (p_what == NOTIFICATION_EXIT_TREE) {
 			running.store(false, std::memory_order_relaxed);
+            scheduler.wake();
 
             if (log_thread.joinable()) log_thread.join();
             if (redstone_thread.joinable()) redstone_thread.join();
             if (scheduler_thread.joinable()) scheduler_thread.join();
-            loop_cv.notify_all();
+            saves.set_on_written(nullptr);
 
-            save_world(file_name);
+            save_world(save_path(), true);
             save_userdata();
         }
     }
@@ -266,6 +299,9 @@ void fragment() {
     none Main::start_log_thread() {
         if (log_thread.joinable()) return;
 
+        LogQueue::console = [](const Str& log) { UtilityFunctions::print(log.std_str().c_str()); };
+        LogQueue::directory = ProjectSettings::get_singleton()->globalize_path("user://game/logs/").utf8().get_data();
+
         auto worker = [this]() {
             ThreadRegistry::register_thread("Log Thread");
             log<LogType::INFO>("Log thread started");
@@ -301,18 +337,33 @@ void fragment() {
             ThreadRegistry::register_thread("Scheduler Thread");
             log<LogType::INFO>("Scheduler thread started");
 
-            auto last_unload_time = std::chrono::high_resolution_clock::now();
+            // Chunks stay loaded while a ticket holds them. The player's ticket follows the player and covers the
+            // render distance plus the unload slack; whatever it lets go of is unloaded on the same tick.
+            Pos<int> last_budget_check(0, 0, 0);
+            bool budget_checked = false;
             while (running.load(std::memory_order_relaxed)) {
-                submit_jobs();
+                const int px = (int)std::floor(player_x.load() / Chunk::SIZE_X);
+                const int pz = (int)std::floor(player_z.load() / Chunk::SIZE_Z);
+                const int32 player_level = render_distance + ChunkScheduler::MAX_LEAD + 1;
+                if (player_ticket == 0) player_ticket = tickets.add(TicketReason::PLAYER, Pos<int>(px, 0, pz), player_level);
+                else tickets.move(player_ticket, Pos<int>(px, 0, pz), player_level);
 
-                auto now = std::chrono::high_resolution_clock::now();
-                if (std::chrono::duration_cast<std::chrono::seconds>(now - last_unload_time).count() >= 5) {
-                    unload_distant_chunks((int)(player_x.load() / Chunk::SIZE_X), (int)(player_z.load() / Chunk::SIZE_Z));
-                    last_unload_time = now;
+                submit_jobs();
+                load_ticketed_chunks();
+                release_chunks();
+
+                // Memory only grows as the player moves into new chunks, so the budget follows the player instead of a timer
+                if (not budget_checked or force_unload_pass.exchange(false) or std::max(std::abs(px - last_budget_check.x), std::abs(pz - last_budget_check.z)) >= unload_step) {
+                    enforce_memory_budget(px, pz);
+                    last_budget_check = Pos<int>(px, 0, pz);
+                    budget_checked = true;
                 }
 
-                std::unique_lock<std::mutex> lock(loop_mutex);
-                loop_cv.wait_for(lock, std::chrono::milliseconds(sleep_time_cpu));
+                // Chunks and meshes dropped on the main thread are only parked; destroying the excess happens here
+                ChunkPool::trim();
+                MeshDataPool::trim();
+
+                scheduler.wait();
             }
         });
     }
@@ -320,112 +371,141 @@ void fragment() {
     none Main::submit_jobs() {
         const int px = (int)std::floor(player_x.load() / Chunk::SIZE_X);
         const int pz = (int)std::floor(player_z.load() / Chunk::SIZE_Z);
-        static constexpr int max_jobs_per_tick = 32;
-        int submitted = 0;
-
-        for (auto r : range<int>(render_distance + 1)) {
-            for (auto x : range<int>(-r, r + 1)) {
-                for (auto z : range<int>(-r, r + 1)) {
-                    if (std::abs(x) != r and std::abs(z) != r) continue;
-
-                    Pos<int> chunk_pos{ px + x, 0, pz + z };
-                    auto chunk = get_or_create_chunk(chunk_pos);
-
-                    // Terrain
-                    if (not chunk.value().generated.load(std::memory_order_acquire)) {
-                        {
-                            std::lock_guard lock(pending_jobs_mutex);
-                            if (pending_terrain_jobs.contains(chunk_pos)) continue;
-                            pending_terrain_jobs.insert(chunk_pos);
-                        }
-
-                        terrain_pool.enqueue([this, chunk, chunk_pos]() {
-                            if (running.load()) {
-                                auto& _chunk = chunk.value();
-                                if (not _chunk.generated.load(std::memory_order_acquire)) {
-                                    _chunk.generate_terrain(world_seed.load(), noise);
-                                    _chunk.dirty.store(true, std::memory_order_release);
-
-                                    Pos<int> offsets[4] = { {1,0,0}, {-1,0,0}, {0,0,1}, {0,0,-1} };
-                                    for (auto& o : offsets) {
-                                        auto n = get_chunk(_chunk.chunk_pos.x + o.x, _chunk.chunk_pos.z + o.z);
-                                        if (n and n.value().generated.load(std::memory_order_acquire)) n.value().dirty.store(true);
-                                    }
-                                }
-                            }
-
-                            std::lock_guard lock(pending_jobs_mutex);
-                            pending_terrain_jobs.erase(chunk_pos);
-                        });
-                    }
-
-                    // Mesh
-                    if (not chunk.value().dirty.load(std::memory_order_acquire) or chunk.value().mesh_ready.load(std::memory_order_acquire)) continue;
-                    
-                    {
-                        std::lock_guard lock(pending_jobs_mutex);
-                        if (pending_mesh_jobs.contains(chunk_pos)) continue;
-                        pending_mesh_jobs.insert(chunk_pos);
-                    }
-
-                    mesh_pool.enqueue([this, chunk, chunk_pos]() {
-                        if (running.load(std::memory_order_relaxed)) {
-                            auto& _chunk = chunk.value();
-                            if (_chunk.dirty.load() or _chunk.mesh_ready.load()) {
-                                Ptr<Chunk> neighbors[4] = {
-                                    get_chunk(_chunk.chunk_pos.x + 1, _chunk.chunk_pos.z),
-                                    get_chunk(_chunk.chunk_pos.x - 1, _chunk.chunk_pos.z),
-                                    get_chunk(_chunk.chunk_pos.x, _chunk.chunk_pos.z + 1),
-                                    get_chunk(_chunk.chunk_pos.x, _chunk.chunk_pos.z - 1)
-                                };
-
-                                _chunk.generate_mesh(neighbors);
-                                _chunk.mesh_ready.store(true);
-                                _chunk.dirty.store(false);
-                            }
-                        }
-
-                        std::lock_guard lock(pending_jobs_mutex);
-                        pending_mesh_jobs.erase(chunk_pos);
+        // A few jobs per worker keeps every lane fed; the rest waits in the scheduler, where it can still be reordered
+        const int32 max_jobs_in_flight = static_cast<int32>(jobs.worker_count()) * 4;
+
+        scheduler.update(px, pz,
+            view_x.load(std::memory_order_relaxed), view_z.load(std::memory_order_relaxed),
+            velocity_x.load(std::memory_order_relaxed), velocity_z.load(std::memory_order_relaxed),
+            render_distance);
+
+        // Chunks with a job in flight or nothing to do are dropped here; the job end or mark_dirty() queues them again
+        Pos<int> chunk_pos;
+        while (jobs_in_flight.load(std::memory_order_acquire) < max_jobs_in_flight and scheduler.pop(chunk_pos)) {
+            auto chunk = get_or_create_chunk(chunk_pos);
+            const int r = std::max(std::abs(chunk_pos.x - px), std::abs(chunk_pos.z - pz));
+            const JobPriority ring_priority = r <= near_ring ? JobPriority::NEAR : JobPriority::FAR;
+
+            // Terrain
+            if (not chunk.value().is_generated()) {
+                if (not chunk.value().try_queue_terrain()) continue;
+
+                submit_terrain(chunk, chunk_pos, ring_priority);
+                continue;
+            }
+
+            // Mesh
+            if (not chunk.value().get_state().dirty()) continue;
+            if (not neighbors_ready(chunk.value(), px, pz)) continue;
+
+            uint32 revision = 0;
+            bool interactive = false;
+            if (not chunk.value().try_queue_mesh(revision, interactive)) continue;
+
+            const uint32 ticket = chunk.value().epoch.load(std::memory_order_acquire);
+            jobs.submit(interactive ? JobPriority::INTERACTIVE : ring_priority, [this, chunk, chunk_pos, ticket, revision]() {
+                auto& _chunk = chunk.value();
+                bool built = false;
+                if (running.load(std::memory_order_relaxed) and not _chunk.is_stale(ticket) and in_job_range(chunk_pos)) {
+                    built = _chunk.generate_mesh(ticket);
+                }
+
+                // An edit during the build left the revision ahead, so the chunk stays dirty and finish_job() requeues it
+                _chunk.finish_mesh(revision, built);
+                finish_job(chunk_pos);
+            });
+
+            jobs_in_flight.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+
+    // Terrain, or the chunk's stored copy when its region file has one. The caller has called try_queue_terrain().
+    none Main::submit_terrain(IPtr<Chunk> chunk, const Pos<int>& chunk_pos, JobPriority priority) {
+        const uint32 ticket = chunk.value().epoch.load(std::memory_order_acquire);
+        jobs.submit(priority, [this, chunk, chunk_pos, ticket]() {
+            auto& _chunk = chunk.value();
+            if (running.load() and not _chunk.is_stale(ticket) and in_job_range(chunk_pos)) {
+                // A chunk that was unloaded comes back from its region file or the write-behind queue, edits and all
+                const bool restored = saves.restore(chunk_pos, _chunk, pending_writes);
+                auto outgoing = restored ? std::vector<PendingBatch>{} : _chunk.generate_terrain(world_seed.load(), noise, pending_writes, nullptr, ticket);
+
+                // Still ungenerated means the job was cancelled before the commit
+                if (_chunk.is_generated()) {
+                    pending_writes.submit(std::move(outgoing), [this](const PendingBatch& batch) {
+                        Reclaimer::Guard guard;
+                        View<Chunk> target = chunks.peek(batch.chunk);
+                        if (not target or not target.value().is_generated()) return false;
+                        target.value().apply_pending(batch.blocks);
+                        return true;
                     });
 
-                    if (++submitted >= max_jobs_per_tick) return;
+                    // A neighbour that is already clean was meshed while this chunk was past the edge, so it has a
+                    // wall of faces here and needs another pass. The others may have been waiting for this chunk.
+                    _chunk.for_each_neighbor([this](size, Chunk& n) {
+                        if (not n.is_generated()) return;
+                        n.mark_dirty();
+                        scheduler.request(Pos<int>(n.chunk_pos.x, 0, n.chunk_pos.z));
+                    });
                 }
             }
-        }
+
+            _chunk.finish_terrain();
+            finish_job(chunk_pos);
+        });
+
+        jobs_in_flight.fetch_add(1, std::memory_order_acq_rel);
     }
 
-    Ptr<Chunk> Main::get_or_create_chunk(const Pos<int>& chunk_pos) {
-        {
-            std::shared_lock lock(chunks_mutex);
-            auto it = chunks.find(chunk_pos);
-            if (it != chunks.end()) return it->second;
-        }
+    // Checked when a job starts. A ring of slack keeps the border from flickering.
+    // Chunks held by a ticket other than a player's are always in range, wherever they are.
+    bool Main::in_job_range(const Pos<int>& chunk_pos) {
+        return scheduler.get_area().contains(chunk_pos, 1) or tickets.is_held_apart_from_players(chunk_pos);
+    }
 
-        std::unique_lock lock(chunks_mutex);
-        auto it = chunks.find(chunk_pos);
-        if (it != chunks.end()) return it->second;
+    // A chunk is meshed once every neighbour has terrain, or lies past the render distance and will not get any
+    // until the player moves; meshing earlier emits border walls that have to be redone when the neighbour lands.
+    bool Main::neighbors_ready(const Chunk& chunk, int p_cx, int p_cz) {
+        Reclaimer::Guard guard;
+        for (auto side : range<size>(Chunk::NEIGHBOR_COUNT)) {
+            const int x = chunk.chunk_pos.x + Chunk::NEIGHBOR_OFFSETS[side][0];
+            const int z = chunk.chunk_pos.z + Chunk::NEIGHBOR_OFFSETS[side][1];
+            if (std::abs(x - p_cx) > render_distance or std::abs(z - p_cz) > render_distance) continue;
+
+            const Chunk* n = chunk.neighbor(side);
+            if (not n or not n->is_generated()) return false;
+        }
+        return true;
+    }
 
-        Ptr<Chunk> chunk(new Chunk());
-        chunk.value().chunk_pos = chunk_pos;
-        chunks[chunk_pos] = chunk;
-        return chunk;
+    // Called at the end of every chunk job, cancelled or not
+    none Main::finish_job(const Pos<int>& chunk_pos) {
+        jobs_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+        scheduler.request(chunk_pos);
+        scheduler.wake();
     }
 
-    none Main::create_chunk_collision(Ptr<Chunk> chunk, const PackedVector3Array& collision_faces) {
-		std::shared_lock lock(chunks_mutex);
+    IPtr<Chunk> Main::get_or_create_chunk(const Pos<int>& chunk_pos) {
+        return chunks.find_or_insert(chunk_pos, [&]() {
+            IPtr<Chunk> chunk = ChunkPool::acquire();
+            chunk.value().chunk_pos = chunk_pos;
+            chunk.value().scheduler = &scheduler;
+            return chunk;
+        });
+    }
 
-        if (not chunk.value().mesh_instance or chunk.value().collision_built.load(std::memory_order_relaxed)) return;
+    none Main::create_chunk_collision(IPtr<Chunk> chunk, const PackedVector3Array& collision_faces) {
+        MeshInstance3D* mesh_instance = chunk_nodes.find(chunk.value().chunk_pos);
+        if (not mesh_instance or chunk.value().get_state().has(ChunkState::COLLISION_BUILT)) return;
         
-        for (auto i : range<int32>(chunk.value().mesh_instance->get_child_count() - 1, -1)) {
-            Node* child = chunk.value().mesh_instance->get_child(i);
+        for (auto i : range<int32>(mesh_instance->get_child_count() - 1, -1)) {
+            Node* child = mesh_instance->get_child(i);
             if (Object::cast_to<StaticBody3D>(child)) {
-                chunk.value().mesh_instance->remove_child(child);
+                mesh_instance->remove_child(child);
                 child->queue_free();
             }
         }
 
-        Ref<ArrayMesh> mesh = chunk.value().mesh_instance->get_mesh();
+        Ref<ArrayMesh> mesh = mesh_instance->get_mesh();
         if (mesh.is_null() or mesh->get_surface_count() == 0) return;
         if (collision_faces.size() == 0) return;
 
@@ -443,54 +523,221 @@ void fragment() {
         col_shape->set_shape(concave);
         static_body->add_child(col_shape);
 
-        chunk.value().mesh_instance->add_child(static_body);
-        chunk.value().collision_built.store(true, std::memory_order_release);
+        mesh_instance->add_child(static_body);
+        chunk.value().set_flag(ChunkState::COLLISION_BUILT, true);
     }
     
-    none Main::update_chunk_mesh(Ptr<Chunk> chunk, Ref<ArrayMesh> mesh, PackedVector3Array& collision_faces) {
-        if (not chunk.value().mesh_instance) {
-            MeshInstance3D* mi = memnew(MeshInstance3D);
-            mi->set_position(Vector3(chunk.value().chunk_pos.x * Chunk::SIZE_X, 0,chunk.value().chunk_pos.z * Chunk::SIZE_Z));
-            mi->set_material_override(world_material);
-            add_child(mi);
-            chunk.value().mesh_instance = mi;
+    none Main::update_chunk_mesh(IPtr<Chunk> chunk, Ref<ArrayMesh> mesh, PackedVector3Array& collision_faces) {
+        MeshInstance3D* mesh_instance = chunk_nodes.find(chunk.value().chunk_pos);
+        if (not mesh_instance) {
+            mesh_instance = memnew(MeshInstance3D);
+            mesh_instance->set_position(Vector3(chunk.value().chunk_pos.x * Chunk::SIZE_X, 0,chunk.value().chunk_pos.z * Chunk::SIZE_Z));
+            mesh_instance->set_material_override(world_material);
+            add_child(mesh_instance);
+            chunk_nodes.insert(chunk.value().chunk_pos, mesh_instance);
         }
 
-        chunk.value().mesh_instance->set_mesh(mesh);
+        mesh_instance->set_mesh(mesh);
 		create_chunk_collision(chunk, collision_faces);
     }
 
-    none Main::unload_distant_chunks(int p_cx, int p_cz) {
-        const int unload_dist = render_distance + 4;
-        List<Pos<int>> chunks_to_remove;
+    // Chunks held by something other than a player may lie outside the loaded area, where the scheduler never looks,
+    // so their terrain is queued here. They are meshed only once a player comes close.
+    none Main::load_ticketed_chunks() {
+        for (const auto& pos : tickets.take_acquired()) {
+            if (not tickets.is_held_apart_from_players(pos)) continue;
+
+            auto chunk = get_or_create_chunk(pos);
+            if (chunk.value().is_generated() or not chunk.value().try_queue_terrain()) continue;
+            submit_terrain(chunk, pos, JobPriority::BACKGROUND);
+        }
+    }
 
+    // Unloads what lost its last ticket. A chunk with a job in flight is cancelled and retried on a later tick, once
+    // finish_job() has woken the scheduler, so a terrain commit never races the region write. Unloads the main thread
+    // turned down come back through rejected_unloads. A chunk already UNLOADING is left to that unload, which comes
+    // back here if it is turned down.
+    none Main::release_chunks() {
+        std::vector<Pos<int>> released = tickets.take_released();
+        released.insert(released.end(), release_retry.begin(), release_retry.end());
+        release_retry.clear();
         {
-            std::shared_lock lock(chunks_mutex);
-            for (const auto& E : chunks) {
-                int dx = std::abs(E.first.x - p_cx);
-                int dz = std::abs(E.first.z - p_cz);
-                if (dx > unload_dist or dz > unload_dist) {
-                    chunks_to_remove.append(E.first);
-                }
+            std::lock_guard lock(rejected_unloads_mutex);
+            released.insert(released.end(), rejected_unloads.begin(), rejected_unloads.end());
+            rejected_unloads.clear();
+        }
+
+        std::vector<std::pair<Pos<int>, IPtr<Chunk>>> batch;
+        for (const auto& pos : released) {
+            if (tickets.is_held(pos)) continue;
+            auto chunk = chunks.find(pos);
+            if (not chunk) continue;
+
+            if (chunk.value().has_job_in_flight()) {
+                chunk.value().cancel_jobs();
+                release_retry.push_back(pos);
+            }
+            else if (chunk.value().try_mark_unloading()) batch.emplace_back(pos, std::move(chunk));
+        }
+
+        if (not batch.empty()) unload_chunks(std::move(batch));
+    }
+
+    // Past memory_budget_mb, chunks outside the job range are unloaded before their ticket lets go of them, least
+    // recently relevant first. Also cancels jobs still in flight for chunks the player left behind. The worker
+    // rings cannot drop entries, so bumping the epoch makes such jobs stop at their next stage boundary instead.
+    // Distances are measured from the scheduler's area, so chunks prefetched ahead of a moving player are kept.
+    none Main::enforce_memory_budget(int p_cx, int p_cz) {
+        ChunkScheduler::Area area = scheduler.get_area();
+        area.center_x = p_cx;
+        area.center_z = p_cz;
+        area.radius = render_distance;
+        const uint64 pass = relevance_pass.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        struct Candidate {
+            uint64 last_relevant;
+            int32 distance;
+            size bytes;
+            Pos<int> pos;
+            IPtr<Chunk> chunk;
+        };
+        std::vector<Candidate> candidates;
+        MemoryUsage usage;
+
+        chunks.for_each([&](const Pos<int32>& pos, const IPtr<Chunk>& chunk_ptr) {
+            auto& chunk = chunk_ptr.value();
+            if (chunk.get_state().has(ChunkState::UNLOADING)) return;
+
+            const size storage = chunk.storage_bytes();
+            const size mesh = chunk.mesh_bytes.load(std::memory_order_relaxed);
+            const size collision = chunk.collision_bytes.load(std::memory_order_relaxed);
+            ++usage.chunks;
+            usage.storage += storage;
+            usage.mesh += mesh;
+            usage.collision += collision;
+
+            if (area.contains(pos, 1)) chunk.last_relevant.store(pass, std::memory_order_relaxed);
+            else if (tickets.is_held_apart_from_players(pos)) return;
+            else if (chunk.has_job_in_flight()) chunk.cancel_jobs();
+            else {
+                const int32 distance = std::max(std::abs(pos.x - p_cx), std::abs(pos.z - p_cz));
+                candidates.push_back({ chunk.last_relevant.load(std::memory_order_relaxed), distance, storage + mesh + collision, pos, chunk_ptr });
+            }
+        });
+
+        const size budget = memory_budget_mb.load(std::memory_order_relaxed) * 1024 * 1024;
+        std::vector<std::pair<Pos<int>, IPtr<Chunk>>> batch;
+        if (usage.total() > budget) {
+            std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+                if (a.last_relevant != b.last_relevant) return a.last_relevant < b.last_relevant;
+                return a.distance > b.distance;
+            });
+
+            size used = usage.total();
+            for (auto& candidate : candidates) {
+                if (used <= budget) break;
+                if (not candidate.chunk.value().try_mark_unloading()) continue;
+
+                used -= candidate.bytes;
+                ++usage.evicted;
+                batch.emplace_back(candidate.pos, std::move(candidate.chunk));
             }
+
+            // What is left is in the job range, and unloading it would only make the scheduler load it again
+            if (used > budget and not over_budget) {
+                log<LogType::WARNING>(format{} << "Memory budget of " << memory_budget_mb.load(std::memory_order_relaxed) << " MB is too small for render distance " << render_distance);
+            }
+            over_budget = used > budget;
         }
+        else over_budget = false;
+
+        {
+            std::lock_guard lock(memory_usage_mutex);
+            memory_usage = usage;
+        }
+
+        if (not batch.empty()) {
+            log<LogType::VERBOSE>(format{} << "Unloading " << batch.size() << " chunks over the memory budget.");
+            unload_chunks(std::move(batch));
+        }
+    }
+
+    // The chunks are marked UNLOADING. Those with unsaved changes are handed to the save service, which writes
+    // them behind; all are then handed to the main thread to drop. The rest are generated again from the seed
+    // when needed, or read back from the copy already stored. Chunks a full write-behind queue turns down stay
+    // loaded and go to release_retry; the service wakes the scheduler as each batch is written.
+    none Main::unload_chunks(std::vector<std::pair<Pos<int>, IPtr<Chunk>>> batch) {
+        List<PendingUnload> unloads;
+        size deferred = 0;
+        for (const auto& [pos, chunk] : batch) {
+            const ChunkState state = chunk.value().get_state();
+            if (chunk.value().unsaved() and not saves.write_behind(pos, chunk)) {
+                chunk.value().set_flag(ChunkState::UNLOADING, false);
+                release_retry.push_back(pos);
+                ++deferred;
+                continue;
+            }
+            unloads.append({ pos, state.revision() });
+        }
+        if (deferred != 0) log<LogType::VERBOSE>(format{} << "Write-behind queue full, keeping " << deferred << " chunks loaded");
 
         {
             std::lock_guard lock(chunks_to_remove_mutex);
-            this->chunks_to_remove += chunks_to_remove;
+            chunks_to_remove += unloads;
         }
         should_remove_chunks.store(true, std::memory_order_release);
+    }
 
-        if (chunks_to_remove) log<LogType::VERBOSE>(format{} << "Queued unload for " << len(chunks_to_remove) << " chunks.");
+    Str Main::memory_report() const {
+        MemoryUsage usage;
+        {
+            std::lock_guard lock(memory_usage_mutex);
+            usage = memory_usage;
+        }
+
+        auto mb = [](uint64 bytes) { return static_cast<float64>(bytes) / (1024.0 * 1024.0); };
+        return format{}
+            << "Chunks: " << usage.chunks << " resident, " << mb(usage.total()) << " MB of " << memory_budget_mb.load(std::memory_order_relaxed) << " MB budget\n"
+            << "  storage " << mb(usage.storage) << " MB, mesh " << mb(usage.mesh) << " MB, collision " << mb(usage.collision) << " MB\n"
+            << "  " << usage.evicted << " evicted over budget in the last pass\n"
+            << "Regions: " << regions.open_count() << " open, " << mb(regions.bytes()) << " MB on disk\n"
+            << "Pools: " << ChunkPool::spare_count() << " spare chunks, " << MeshDataPool::spare_count() << " spare meshes";
     }
 
-    Ptr<Chunk> Main::get_chunk(int cx, int cz) {
-        std::shared_lock lock(chunks_mutex);
-        Pos<int> cpos(cx, 0, cz);
+    none Main::set_memory_budget(size mb) {
+        memory_budget_mb.store(mb, std::memory_order_relaxed);
+        force_unload_pass.store(true, std::memory_order_relaxed);
+        scheduler.wake();
+    }
+
+    // Keeps the square of radius level around chunk_pos loaded until removed. One forced ticket per position.
+    bool Main::add_forced_ticket(const Pos<int>& chunk_pos, int32 level) {
+        if (forced_tickets.contains(chunk_pos)) return false;
+        forced_tickets[chunk_pos] = tickets.add(TicketReason::FORCED, chunk_pos, level);
+        scheduler.wake();
+        return true;
+    }
+
+    bool Main::remove_forced_ticket(const Pos<int>& chunk_pos) {
+        auto it = forced_tickets.find(chunk_pos);
+        if (it == forced_tickets.end()) return false;
 
-        auto it = chunks.find(cpos);
-        if (it == chunks.end()) return nullptr;
-        return it->second;
+        tickets.remove(it->second);
+        forced_tickets.erase(it);
+        scheduler.wake();
+        return true;
+    }
+
+    Str Main::ticket_report() const {
+        Str report = format{} << "Tickets hold " << tickets.held_count() << " chunks";
+        for (const auto& [id, ticket] : tickets.list()) {
+            report += format{} << "\n  #" << id << " " << ticket_reason_name(ticket.reason) << " at (" << ticket.pos.x << ", " << ticket.pos.z << ") level " << ticket.level;
+        }
+        return report;
+    }
+
+    IPtr<Chunk> Main::get_chunk(int cx, int cz) {
+        return chunks.find(Pos<int>(cx, 0, cz));
     }
     
     uint32 Main::get_global_block_id(int wx, int wy, int wz) {
@@ -500,7 +747,8 @@ void fragment() {
         int cz = static_cast<int>(std::floor((float32)wz / Chunk::SIZE_Z));
         Pos<int> cpos(cx, 0, cz);
 
-        Ptr<Chunk> chunk = get_chunk(cx, cz);
+        Reclaimer::Guard guard;
+        View<Chunk> chunk = chunks.peek(cpos);
         if (not chunk) return BlockRegistry::get_id("Air");
 
         int lx = (wx % Chunk::SIZE_X + Chunk::SIZE_X) % Chunk::SIZE_X;
@@ -516,100 +764,76 @@ void fragment() {
         int cz = static_cast<int>(std::floor((float32)wz / Chunk::SIZE_Z));
         Pos<int> cpos(cx, 0, cz);
 
-        Ptr<Chunk> chunk = get_chunk(cx, cz);
+        IPtr<Chunk> chunk = get_chunk(cx, cz);
         if (not chunk) return;
 
         int lx = (wx % Chunk::SIZE_X + Chunk::SIZE_X) % Chunk::SIZE_X;
         int lz = (wz % Chunk::SIZE_Z + Chunk::SIZE_Z) % Chunk::SIZE_Z;
 
         chunk.value().set_block({ (uint8)lx, (uint8)wy, (uint8)lz }, block_id);
-    }
+        chunk.value().last_relevant.store(relevance_pass.load(std::memory_order_relaxed), std::memory_order_relaxed);
 
-    none Main::save_world(const Str& path) {
-        String real_path = ProjectSettings::get_singleton()->globalize_path(path.std_str().c_str());
-        std::string std_path = real_path.utf8().get_data();
-
-        // Tạo thư mục
-        std::filesystem::create_directories(std::filesystem::path(std_path).parent_path());
+        // Remesh this chunk and any neighbour sharing the face first
+        chunk.value().mark_dirty(true);
+        const bool on_border[Chunk::NEIGHBOR_COUNT] = { lx == Chunk::SIZE_X - 1, lx == 0, lz == Chunk::SIZE_Z - 1, lz == 0 };
+        chunk.value().for_each_neighbor([&on_border](size side, Chunk& n) {
+            if (on_border[side]) n.mark_dirty(true);
+        });
+    }
 
-        std::ofstream ofs(std_path, std::ios::binary);
-        if (not ofs.is_open()) {
-            log<LogType::ERROR>(format{} << "Cannot open save file: " << std_path);
-            return;
-        }
+    Str Main::save_path() const {
+        return format{} << "user://game/saves/" << world_name << "/overworld.cbsave";
+    }
 
+    // Copies what the save needs and hands it to the save service; the frame only pays for a memcpy per chunk
+    // changed since its last write. Unmodified terrain is generated again from the seed, and unloaded chunks
+    // were written on the way out. wait blocks until the save is on disk.
+    none Main::save_world(const Str& path, bool wait) {
         Player* player = static_cast<Player*>(player_ptr);
         if (not player) {
             log<LogType::ERROR>("Failed to cast to Player*");
             return;
         }
 
-        log<LogType::INFO>("Saving world...");
-
-        size version_len = strlen(version);
-        ofs.write(reinterpret_cast<const byte*>(&version_len), sizeof(size));
-
-        ofs.write(version, sizeof(char) * version_len);
-
-        std::vector<std::pair<Pos<int>, Ptr<Chunk>>> chunks_to_save;
-        {
-            std::shared_lock lock(chunks_mutex);
-
-            uint32 seed = noise->get_seed();
-            ofs.write(reinterpret_cast<const byte*>(&seed), sizeof(uint32));
-
-            for (const auto& E : chunks) {
-                if (E.second.value().generated.load(std::memory_order_acquire)) {
-                    chunks_to_save.emplace_back(E.first, E.second);
-                }
-            }
-        }
-
-        uint32 chunk_count = static_cast<uint32>(chunks_to_save.size());
-        ofs.write(reinterpret_cast<const byte*>(&chunk_count), sizeof(uint32));
-
-        for (const auto& [pos, chunk] : chunks_to_save) {
-            std::shared_lock data_lock(chunk.value().data_mutex);
-
-            ofs.write(reinterpret_cast<const byte*>(&pos.x), sizeof(int32));
-            ofs.write(reinterpret_cast<const byte*>(&pos.y), sizeof(int32));
-            ofs.write(reinterpret_cast<const byte*>(&pos.z), sizeof(int32));
-
-            const auto* data = &chunk.value().blocks[0][0][0];
-            ofs.write(reinterpret_cast<const byte*>(data), Chunk::SIZE_X * Chunk::SIZE_Y * Chunk::SIZE_Z * sizeof(BlockStorage));
+        String real_path = ProjectSettings::get_singleton()->globalize_path(path.std_str().c_str());
 
-            uint8 block_ids_size = static_cast<uint8>(chunk.value().block_ids.size());
-            ofs.write(reinterpret_cast<const byte*>(&block_ids_size), sizeof(uint8));
-            for (const auto& [local_id, global_id] : chunk.value().block_ids) {
-                ofs.write(reinterpret_cast<const byte*>(&local_id), sizeof(uint8));
-                ofs.write(reinterpret_cast<const byte*>(&global_id), sizeof(uint32));
-            }
+        WorldSnapshot snapshot;
+        snapshot.path = real_path.utf8().get_data();
+        snapshot.seed = static_cast<uint32>(world_seed.load(std::memory_order_acquire));
 
-            uint8 tag_ids_size = static_cast<uint8>(chunk.value().tag_ids.size());
-            ofs.write(reinterpret_cast<const byte*>(&tag_ids_size), sizeof(uint8));
-            for (const auto& [local_id, global_id] : chunk.value().tag_ids) {
-                ofs.write(reinterpret_cast<const byte*>(&local_id), sizeof(uint8));
-                ofs.write(reinterpret_cast<const byte*>(&global_id.first), sizeof(uint32));
-                ofs.write(reinterpret_cast<const byte*>(&global_id.second), sizeof(size));
-            }
+        chunks.for_each([&](const Pos<int32>& pos, const IPtr<Chunk>& chunk) {
+            if (chunk.value().unsaved()) snapshot.chunks.push_back(SaveService::snapshot(pos, chunk));
+        });
 
-            uint32 complex_size = static_cast<uint32>(chunk.value().complex_blocks.size());
-            ofs.write(reinterpret_cast<const byte*>(&complex_size), sizeof(uint32));
+        std::ostringstream player_data;
+        player->save_data(player_data);
+        snapshot.sections.emplace_back(SaveSection::PLAYER, player_data.str());
 
-            for (const auto& pair : chunk.value().complex_blocks) {
-                ofs.write(reinterpret_cast<const byte*>(&pair.first.x), sizeof(uint8));
-                ofs.write(reinterpret_cast<const byte*>(&pair.first.y), sizeof(uint8));
-                ofs.write(reinterpret_cast<const byte*>(&pair.first.z), sizeof(uint8));
+        std::ostringstream pending_data;
+        pending_writes.save(pending_data);
+        snapshot.sections.emplace_back(SaveSection::PENDING_WRITES, pending_data.str());
 
-                ofs.write(reinterpret_cast<const byte*>(&pair.second.block_id), sizeof(uint32));
-                ofs.write(reinterpret_cast<const byte*>(&pair.second.tag), sizeof(uint32));
-            }
-        }
+        log<LogType::INFO>("Saving world...");
+        log<LogType::VERBOSE>(format{} << snapshot.chunks.size() << " modified chunks to write");
+        saves.submit(std::move(snapshot));
+        if (wait) saves.flush();
+    }
 
-        player->save_data(ofs);
+    Str Main::save_report() const {
+        const SaveStats stats = saves.get_stats();
+        const int32 autosave = autosave_minutes.load(std::memory_order_relaxed);
+        Str report = format{}
+            << "Saves: " << stats.saves << " written" << (saves.busy() ? ", one in progress" : "") << "\n"
+            << "  last: " << stats.chunks << " chunks in " << stats.seconds << " s" << (stats.failed ? ", incomplete" : "") << "\n"
+            << "  unloaded: " << stats.unloaded << " chunks written behind, " << stats.queued << " queued\n";
+        if (autosave > 0) report += format{} << "  autosave every " << autosave << " min";
+        else report += "  autosave off";
+        return report;
+    }
 
-        log<LogType::INFO>(format{} << "World saved!");
-        log<LogType::VERBOSE>(format{} << chunk_count << " chunks");
+    none Main::set_autosave_interval(int32 minutes) {
+        autosave_minutes.store(std::max(minutes, 0), std::memory_order_relaxed);
+        autosave_timer = 0;
     }
 
     bool Main::load_world(const Str& path) {
@@ -627,88 +851,72 @@ void fragment() {
 
         log<LogType::INFO>("Loading world...");
 
-        size version_len = 0;
-        ifs.read(reinterpret_cast<byte*>(&version_len), sizeof(size));
-
-        char* current_version = new char[version_len + 1]; current_version[version_len] = '\0';
-        ifs.read(current_version, sizeof(char) * version_len);
-        if (strcmp(current_version, version)) log<LogType::WARNING>(format{} << "Save version" << "(" << current_version << ")" << " mismatch with current version (" << version << ")");
-        delete[] current_version;
-
-        uint32 seed = 0;
-        ifs.read(reinterpret_cast<byte*>(&seed), sizeof(uint32));
-        noise->set_seed(seed);
-        world_seed.store(static_cast<int32>(seed), std::memory_order_release);
-
-        uint32 chunk_count = 0;
-        ifs.read(reinterpret_cast<byte*>(&chunk_count), sizeof(uint32));
-
-        {
-            std::unique_lock lock(chunks_mutex);
-            chunks.clear();
+        SaveHeader header;
+        if (not SaveFile::read_header(ifs, header)) {
+            log<LogType::ERROR>(format{} << "Corrupted save header: " << std_path);
+            return false;
         }
-
-        for (auto i : range<uint32>(chunk_count)) {
-            Pos<int> pos;
-            ifs.read(reinterpret_cast<byte*>(&pos.x), sizeof(int32));
-            ifs.read(reinterpret_cast<byte*>(&pos.y), sizeof(int32));
-            ifs.read(reinterpret_cast<byte*>(&pos.z), sizeof(int32));
-
-            auto chunk = get_or_create_chunk(pos);
-            std::unique_lock data_lock(chunk.value().data_mutex);
-
-            uint32 size = Chunk::SIZE_X * Chunk::SIZE_Y * Chunk::SIZE_Z * sizeof(BlockStorage);
-            ifs.read(reinterpret_cast<byte*>(&chunk.value().blocks[0][0][0]), size);
-
-            uint8 block_ids_size = 0;
-            ifs.read(reinterpret_cast<byte*>(&block_ids_size), sizeof(uint8));
-            for (auto j : range<uint8>(block_ids_size)) {
-                uint8 local_id;
-                uint32 global_id;
-                ifs.read(reinterpret_cast<byte*>(&local_id), sizeof(uint8));
-                ifs.read(reinterpret_cast<byte*>(&global_id), sizeof(uint32));
-                chunk.value().block_ids[local_id] = global_id;
-            }
-
-            uint8 tag_ids_size = 0;
-            ifs.read(reinterpret_cast<byte*>(&tag_ids_size), sizeof(uint8));
-            for (auto j : range<uint8>(tag_ids_size)) {
-                uint8 local_id;
-                std::pair<uint32, size_t> global_id;
-                ifs.read(reinterpret_cast<byte*>(&local_id), sizeof(uint8));
-                ifs.read(reinterpret_cast<byte*>(&global_id.first), sizeof(uint32));
-                ifs.read(reinterpret_cast<byte*>(&global_id.second), sizeof(size));
-                chunk.value().tag_ids[local_id] = global_id;
+        if (header.version != version) log<LogType::WARNING>(format{} << "Save version" << "(" << header.version << ")" << " mismatch with current version (" << version << ")");
+
+        world_seed.store(static_cast<int32>(header.seed), std::memory_order_release);
+
+        chunks.clear();
+        chunk_nodes.clear();
+        scheduler.clear();
+
+        // Chunks are not read here: the terrain stage finds them in the region files as the player comes close.
+        // Saves before format 3 carry them inline, so those are moved to region files once, through one scratch chunk.
+        // Anything that keeps some from getting there leaves a copy of the save beside it, as the next save drops them.
+        auto keep_copy = [&std_path]() {
+            std::error_code error;
+            const std::string copy_path = std_path + ".old";
+            std::filesystem::copy_file(std_path, copy_path, std::filesystem::copy_options::overwrite_existing, error);
+            if (error) log<LogType::ERROR>(format{} << "Cannot keep a copy of the save at " << copy_path);
+            else log<LogType::WARNING>(format{} << "Kept a copy of the save at " << copy_path);
+        };
+        IPtr<Chunk> scratch = header.chunk_count > 0 ? ChunkPool::acquire() : nullptr;
+        uint32 migrated = 0;
+        for (auto i : range<uint32>(header.chunk_count)) {
+            const Pos<int32> pos = SaveFile::read_chunk_pos(ifs);
+            scratch.value().reset();
+            // The sections come after the chunks, so nothing past this point can be found
+            if (not SaveFile::read_chunk(ifs, scratch.value())) {
+                log<LogType::ERROR>(format{} << "Corrupted chunk " << i << " of " << header.chunk_count << " in save: " << std_path);
+                keep_copy();
+                return false;
             }
+            if (regions.write(pos, scratch.value())) ++migrated;
+        }
 
-            uint32 complex_size = 0;
-            ifs.read(reinterpret_cast<byte*>(&complex_size), sizeof(uint32));
-
-            auto& map = chunk.value().complex_blocks;
-            for (auto j : range<uint32>(complex_size)) {
-                uint8 x, y, z;
-                uint32 block_id, tag;
-
-                ifs.read(reinterpret_cast<byte*>(&x), sizeof(uint8));
-                ifs.read(reinterpret_cast<byte*>(&y), sizeof(uint8));
-                ifs.read(reinterpret_cast<byte*>(&z), sizeof(uint8));
-
-                ifs.read(reinterpret_cast<byte*>(&block_id), sizeof(uint32));
-                ifs.read(reinterpret_cast<byte*>(&tag), sizeof(uint32));
-
-                Pos<uint8> key{ x, y, z };
-                BlockStorageFull value{ block_id, tag };
-
-                chunk.value().complex_blocks.emplace(key, value);
+        pending_writes.clear();
+        if (header.format >= 2) {
+            for (const auto& [id, payload] : SaveFile::read_sections(ifs)) {
+                std::istringstream section(payload);
+                switch (id) {
+                case SaveSection::PLAYER:         player->load_data(section); break;
+                case SaveSection::PENDING_WRITES: pending_writes.load(section); break;
+                default: break;
+                }
             }
-
-            chunk.value().generated.store(true, std::memory_order_release);
-            chunk.value().dirty.store(true, std::memory_order_release);
-            chunk.value().mesh_ready.store(false, std::memory_order_release);
-            chunk.value().collision_built.store(false, std::memory_order_release);
+        }
+        else {
+            // Format 1 ends with the raw player record, optionally followed by the pending writes
+            player->load_data(ifs);
+            if (ifs.peek() != std::char_traits<char>::eof()) pending_writes.load(ifs);
         }
 
-        player->load_data(ifs);
+        // Rewritten in the current format right away, so the inline copies are never read over newer region data.
+        // Only once every chunk is in a region file, since the rewrite drops them from the save.
+        const bool rewritten = header.chunk_count > 0 and migrated == header.chunk_count;
+        if (rewritten) {
+            ifs.close();
+            save_world(path, true);
+            log<LogType::INFO>(format{} << "Moved " << migrated << " chunks to region files");
+        }
+        else if (header.chunk_count > 0) {
+            log<LogType::ERROR>(format{} << "Moved only " << migrated << " of " << header.chunk_count << " chunks to region files");
+            keep_copy();
+        }
 
         log<LogType::INFO>("World loaded successfully!");
         return true;
@@ -795,11 +1003,12 @@ void fragment() {
         render_distance = rd;
         SIZE_X = render_distance * 16;
         SIZE_Z = render_distance * 16;
+        scheduler.wake();
     }
 
-    none Main::set_sleep_time_cpu(int32 stc) {
-        sleep_time_cpu = stc;
-    }
+    // Does nothing: the scheduler thread is woken by events and no longer sleeps between passes. Still bound so
+    // settings scripts that call it keep working.
+    none Main::set_sleep_time_cpu(int32 stc) {}
     
     none Main::_bind_methods() {
         ADD_SIGNAL(MethodInfo("chat_output", PropertyInfo(Variant::STRING, "line")));
@@ -7,7 +7,6 @@ module;
 #include <godot_cpp/classes/static_body3d.hpp>
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/shader_material.hpp>
-#include <godot_cpp/classes/fast_noise_lite.hpp>
  
 #include <includes.hpp>
 #include <thread>
@@ -35,20 +34,52 @@ import game.thread;
 import game.environment;
 import game.world.chunk;
 import game.world.biome;
+import game.world.noise;
+import game.world.pending_writes;
+import game.world.scheduler;
+import game.world.chunk_map;
+import game.world.chunk_nodes;
+import game.world.region;
+import game.world.save_service;
+import game.world.tickets;
 import game.block.normal_blocks;
 import game.texture.atlas_texture;
 
 using namespace godot;
 
 export namespace craftbuild {
+    // A chunk waiting for the main thread to drop it, already queued for writing if it had unsaved changes
+    struct PendingUnload {
+        Pos<int> pos;
+        uint32 revision;    // When it was queued; a newer one means the chunk changed and stays loaded
+    };
+
+    // Totals from the last unload pass, for the memory command
+    struct MemoryUsage {
+        size chunks = 0;
+        size storage = 0;
+        size mesh = 0;
+        size collision = 0;
+        size evicted = 0;   // Chunks unloaded early to stay within the budget
+
+        size total() const {
+            return storage + mesh + collision;
+        }
+    };
+
     class Main : public Node3D {
         GDCLASS(Main, Node3D)
 
     private:
-        Dict<Pos<int32>, Ptr<Chunk>> chunks;
-        mutable std::shared_mutex chunks_mutex;
+        ChunkMap chunks;
+        ChunkNodes chunk_nodes;
+        RegionStore regions;
+        SaveService saves{ regions };   // Before jobs, whose terrain jobs restore chunks through it
+        ChunkTickets tickets;
+
+        PendingWrites pending_writes;
 
-        Ref<FastNoiseLite> noise;
+        Noise noise;
         Ref<ShaderMaterial> world_material;
         std::atomic<int32> world_seed = 0;
         Str world_name = "My World";
@@ -61,28 +92,51 @@ export namespace craftbuild {
         std::atomic<float32> player_x = 0;
         std::atomic<float32> player_y = 0;
         std::atomic<float32> player_z = 0;
+        std::atomic<float32> view_x = 0;    // Horizontal look direction, read by the scheduler thread
+        std::atomic<float32> view_z = -1;
+        std::atomic<float32> velocity_x = 0;    // Horizontal, in chunks per second
+        std::atomic<float32> velocity_z = 0;
         std::thread log_thread;
         std::thread redstone_thread;
         std::thread scheduler_thread;
-        ThreadPool terrain_pool{ 4 };
-        ThreadPool mesh_pool{ 4 };
-        std::unordered_set<Pos<int>, Hasher<Pos<int>>> pending_terrain_jobs;
-        std::unordered_set<Pos<int>, Hasher<Pos<int>>> pending_mesh_jobs;
-        std::mutex pending_jobs_mutex;
+        ChunkScheduler scheduler;
+        JobSystem jobs;     // After the scheduler, so jobs still running at shutdown can reach it
 
-		List<Pos<int>> chunks_to_remove;
+		List<PendingUnload> chunks_to_remove;
         std::mutex chunks_to_remove_mutex;
+        std::vector<Pos<int>> rejected_unloads;     // Turned down by the main thread; release_chunks() tries them again
+        std::mutex rejected_unloads_mutex;
         std::atomic<bool> should_remove_chunks = false;
+        std::atomic<bool> force_unload_pass = false;
+        std::atomic<uint64> relevance_pass = 0;
+
+        // Scheduler thread only
+        uint64 player_ticket = 0;
+        std::vector<Pos<int>> release_retry;   // Released while a job was in flight, or turned down by a full write-behind queue
+
+        Dict<Pos<int>, uint64> forced_tickets;  // Main thread only
+
+        MemoryUsage memory_usage;
+        mutable std::mutex memory_usage_mutex;
+        bool over_budget = false;           // Scheduler thread only; warns once per episode
         std::atomic<bool> pausing = true;
         std::atomic<bool> chatting = false;
-        std::mutex loop_mutex;
-        std::condition_variable loop_cv;
+        std::atomic<int32> jobs_in_flight = 0;
+
+        // Main thread only: where the scheduler was last woken for
+        Pos<int> woken_chunk{ 0, 0, 0 };
+        Vector3 woken_view{ 0, 0, -1 };
+        Pos<int> woken_lead{ 0, 0, 0 };
 
         bool full_screen = false;
+        float64 autosave_timer = 0;     // Main thread only, seconds since the last autosave
 
     public:
         inline static int32 render_distance = 32;
-        inline static int32 sleep_time_cpu = 180;
+        inline static constexpr int32 near_ring = 2;     // Rings up to this one are generated at JobPriority::NEAR
+        inline static constexpr int32 unload_step = 2;  // Chunks the player moves before the memory budget is checked again
+        inline static std::atomic<size> memory_budget_mb = 2048;   // Chunk storage, meshes and collision shapes together
+        inline static std::atomic<int32> autosave_minutes = 5;     // 0 turns autosave off
 
         inline static int32 SIZE_X = render_distance * 16;
         inline static int32 SIZE_Z = render_distance * 16;
@@ -97,17 +151,34 @@ export namespace craftbuild {
         none start_redstone_thread();
         none start_scheduler_thread();
         none submit_jobs();
-        Ptr<Chunk> get_or_create_chunk(const Pos<int>& chunk_pos);
-        none create_chunk_collision(Ptr<Chunk> chunk, const PackedVector3Array& collision_faces);
-        none update_chunk_mesh(Ptr<Chunk> chunk, Ref<ArrayMesh> mesh, PackedVector3Array& collision_faces);
-        none unload_distant_chunks(int p_cx, int p_cz);
-
-        Ptr<Chunk> get_chunk(int cx, int cz);
+        none finish_job(const Pos<int>& chunk_pos);
+        bool neighbors_ready(const Chunk& chunk, int p_cx, int p_cz);
+        IPtr<Chunk> get_or_create_chunk(const Pos<int>& chunk_pos);
+        none create_chunk_collision(IPtr<Chunk> chunk, const PackedVector3Array& collision_faces);
+        none update_chunk_mesh(IPtr<Chunk> chunk, Ref<ArrayMesh> mesh, PackedVector3Array& collision_faces);
+        none submit_terrain(IPtr<Chunk> chunk, const Pos<int>& chunk_pos, JobPriority priority);
+        none load_ticketed_chunks();
+        none release_chunks();
+        none enforce_memory_budget(int p_cx, int p_cz);
+        none unload_chunks(std::vector<std::pair<Pos<int>, IPtr<Chunk>>> batch);
+        bool in_job_range(const Pos<int>& chunk_pos);
+
+        Str memory_report() const;
+        none set_memory_budget(size mb);
+
+        bool add_forced_ticket(const Pos<int>& chunk_pos, int32 level);
+        bool remove_forced_ticket(const Pos<int>& chunk_pos);
+        Str ticket_report() const;
+
+        IPtr<Chunk> get_chunk(int cx, int cz);
         uint32 get_global_block_id(int wx, int wy, int wz);
         none set_global_block_id(uint32 block_id, int wx, int wy, int wz);
 
-        none save_world(const Str& path);
+        Str save_path() const;
+        none save_world(const Str& path, bool wait = false);
         bool load_world(const Str& path);
+        Str save_report() const;
+        none set_autosave_interval(int32 minutes);
 
         none save_userdata(const char* path = "user://game/userdata.cbdata");
         bool load_userdata(const char* path = "user://game/userdata.cbdata");
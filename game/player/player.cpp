@@ -235,14 +235,9 @@ namespace craftbuild {
                         const int cx = static_cast<int>(std::floor((float32)block_pos.x / Chunk::SIZE_X));
                         const int cz = static_cast<int>(std::floor((float32)block_pos.z / Chunk::SIZE_Z));
                         if (auto chunk = world->get_chunk(cx, cz)) {
-                            chunk.value().dirty.store(true, std::memory_order_release);
+                            chunk.value().mark_dirty();
 
-                            if (block_pos.x >= 0 or block_pos.z >= 0 or block_pos.x < Chunk::SIZE_X or block_pos.z < Chunk::SIZE_Z) {
-                                Pos<int> neighbor_offsets[4] = { {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1} };
-                                for (const auto& offset : neighbor_offsets) {
-                                    if (auto neighbor = world->get_chunk(cx + offset.x, cz + offset.z)) neighbor.value().dirty.store(true, std::memory_order_release);
-                                }
-                            }
+                            chunk.value().for_each_neighbor([](size, Chunk& neighbor) { neighbor.mark_dirty(); });
                         }
                     }
                 }
@@ -13,17 +13,12 @@ import misc.ptr;
 import misc.str;
 import misc.number;
 import misc.format;
+import game.block;
 import game.logger;
 
 using namespace godot;
 
 export namespace craftbuild {
-    enum class FaceCount : uint8 {
-        ONE = 1,
-        THREE = 3,
-        SIX = 6
-    };
-
     struct AssetLoader {
         inline static Str base_path = "res://assets/textures/block/";
 
@@ -1,5 +1,6 @@
 module;
 
+#include <godot_cpp/classes/texture2d.hpp>
 #include <godot_cpp/classes/texture2d_array.hpp>
 #include <includes.hpp>
 
@@ -11,6 +12,7 @@ import misc.format;
 import misc.ptr;
 import game.block;
 import game.logger;
+import game.texture.asset_loader;
 
 using namespace godot;
 
@@ -24,10 +26,12 @@ export namespace craftbuild {
             Array images;
             int current_layer = 0;
 
-            for (const auto& block : BlockRegistry::registry) {
-                if (block.texture.is_null()) continue;
+            for (auto id : range<size>(BlockRegistry::registry.size())) {
+                const auto& block = BlockRegistry::registry[id];
+                Ref<Texture2D> texture = AssetLoader::load_block_texture(id, block.texture.std_str().c_str(), block.face_count);
+                if (texture.is_null()) continue;
 
-                Ref<Image> original_img = block.texture->get_image();
+                Ref<Image> original_img = texture->get_image();
                 if (original_img.is_null()) continue;
 
                 block.block.value().base_texture_layer = current_layer;
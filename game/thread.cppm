@@ -1,16 +1,30 @@
 module;
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#endif
+
 #include <thread>
 #include <includes.hpp>
 #include <mutex>
-#include <functional>
-#include <queue>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 export module game.thread;
 
 import misc.str;
 import misc.dict;
 import misc.number;
+import misc.format;
 
 export namespace craftbuild {
 	struct ThreadRegistry {
@@ -30,52 +44,455 @@ export namespace craftbuild {
 		}
 	};
 
-    class ThreadPool {
-        std::vector<std::thread> workers;
-        std::queue<std::function<void()>> tasks;
+    // Epoch-based deferred destruction for data read without locks. A reader holds a Reclaimer::Guard while it
+    // follows pointers out of a shared structure; a writer unlinks an object first and then retire()s it, and the
+    // object is destroyed once no guard that could still see it is alive.
+    struct Reclaimer {
+        inline static constexpr size MAX_THREADS = 128;
+        inline static constexpr size COLLECT_THRESHOLD = 64;
 
-        std::mutex mutex;
-        std::condition_variable cv;
-        bool stop;
+        // Static storage starts zeroed: every slot free and outside any guard
+        struct alignas(64) Slot {
+            std::atomic<uint64> epoch;          // 0 while the thread is outside any guard
+            std::atomic<bool> used;
+        };
 
-    public:
-        ThreadPool(size_t n) : stop(false) {
-            for (size_t i = 0; i < n; ++i) {
-                workers.emplace_back([this]() {
-                    while (true) {
-                        std::function<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lock(mutex);
-                            cv.wait(lock, [this] { return stop or not tasks.empty(); });
-
-                            if (stop and tasks.empty()) return;
-
-                            task = std::move(tasks.front());
-                            tasks.pop();
-                        }
-                        task();
+        struct Retired {
+            uint64 epoch;
+            none* object;
+            none (*destroy)(none*);
+        };
+
+        // Destroys whatever is still retired when the program exits
+        struct RetiredList {
+            std::vector<Retired> items;
+            ~RetiredList() {
+                for (auto& item : items) item.destroy(item.object);
+            }
+        };
+
+        inline static Slot slots[MAX_THREADS];
+        // Slots for threads past MAX_THREADS, added under the lock and kept for reuse, so no thread waits for a slot
+        inline static std::mutex overflow_mutex;
+        inline static std::vector<std::unique_ptr<Slot>> overflow;
+        inline static std::atomic<uint64> global_epoch = 1;
+        inline static std::mutex retired_mutex;
+        inline static RetiredList retired;
+
+        // Claims a slot on first use and gives it back when the thread exits
+        struct ThreadSlot {
+            Slot* slot = nullptr;
+            uint32 depth = 0;
+
+            ThreadSlot() {
+                for (auto& candidate : slots) {
+                    if (claim(candidate)) {
+                        slot = &candidate;
+                        return;
                     }
-                });
+                }
+
+                std::lock_guard lock(overflow_mutex);
+                for (auto& candidate : overflow) {
+                    if (claim(*candidate)) {
+                        slot = candidate.get();
+                        return;
+                    }
+                }
+                overflow.push_back(std::make_unique<Slot>());
+                slot = overflow.back().get();
+                slot->used.store(true, std::memory_order_release);
+            }
+
+            ~ThreadSlot() {
+                slot->epoch.store(0, std::memory_order_release);
+                slot->used.store(false, std::memory_order_release);
             }
+
+            static bool claim(Slot& candidate) {
+                bool expected = false;
+                return candidate.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+            }
+        };
+
+        static ThreadSlot& thread_slot() {
+            thread_local ThreadSlot slot;
+            return slot;
         }
 
-        ~ThreadPool() {
-            {
-                std::lock_guard<std::mutex> lock(mutex);
-                stop = true;
+        class Guard {
+        public:
+            Guard() {
+                ThreadSlot& slot = thread_slot();
+                if (slot.depth++ != 0) return;
+
+                // Re-read until stable, so a collect() that saw this slot empty cannot free what the reader finds next
+                auto& epoch = slot.slot->epoch;
+                uint64 current = global_epoch.load(std::memory_order_seq_cst);
+                while (true) {
+                    epoch.store(current, std::memory_order_seq_cst);
+                    const uint64 again = global_epoch.load(std::memory_order_seq_cst);
+                    if (again == current) break;
+                    current = again;
+                }
+            }
+
+            ~Guard() {
+                ThreadSlot& slot = thread_slot();
+                if (--slot.depth == 0) slot.slot->epoch.store(0, std::memory_order_release);
             }
-            cv.notify_all();
 
-            for (auto& w : workers) w.join();
+            Guard(const Guard&) = delete;
+            Guard& operator=(const Guard&) = delete;
+        };
+
+        template <typename T>
+        static none retire(T* object) {
+            if (not object) return;
+
+            const uint64 epoch = global_epoch.fetch_add(1, std::memory_order_seq_cst);
+            bool should_collect;
+            {
+                std::lock_guard lock(retired_mutex);
+                retired.items.push_back({ epoch, object, [](none* p) { delete static_cast<T*>(p); } });
+                should_collect = retired.items.size() >= COLLECT_THRESHOLD;
+            }
+            if (should_collect) collect();
         }
 
-        template<class F>
-        void enqueue(F&& f) {
+        // Destroys every retired object no active guard can still reach. Destructors run on the calling thread.
+        static none collect() {
+            uint64 oldest = UINT64_MAX;
+            auto scan = [&oldest](const Slot& slot) {
+                const uint64 epoch = slot.epoch.load(std::memory_order_seq_cst);
+                if (epoch != 0) oldest = std::min(oldest, epoch);
+            };
+            for (const auto& slot : slots) scan(slot);
+            {
+                // A slot added after this is like one seen empty: its guard re-reads the epoch once it is published
+                std::lock_guard lock(overflow_mutex);
+                for (const auto& slot : overflow) scan(*slot);
+            }
+
+            std::vector<Retired> ready;
             {
-                std::lock_guard<std::mutex> lock(mutex);
-                tasks.emplace(std::forward<F>(f));
+                std::lock_guard lock(retired_mutex);
+                auto split = std::partition(retired.items.begin(), retired.items.end(), [oldest](const Retired& item) {
+                    return item.epoch >= oldest;
+                });
+                ready.assign(split, retired.items.end());
+                retired.items.erase(split, retired.items.end());
+            }
+
+            for (auto& item : ready) item.destroy(item.object);
+        }
+    };
+
+    // Type-erased none() callable stored inline. Callables that do not fit fail to compile instead of
+    // falling back to the heap, so submitting a job never allocates.
+    class Job {
+    public:
+        inline static constexpr size STORAGE = 48;
+        inline static constexpr size ALIGNMENT = 16;
+
+    private:
+        struct Ops {
+            none (*invoke)(none* self);
+            none (*relocate)(none* to, none* from) noexcept;
+            none (*destroy)(none* self) noexcept;
+        };
+
+        template <typename F>
+        inline static constexpr Ops OPS = {
+            [](none* self) { (*static_cast<F*>(self))(); },
+            [](none* to, none* from) noexcept {
+                new (to) F(std::move(*static_cast<F*>(from)));
+                static_cast<F*>(from)->~F();
+            },
+            [](none* self) noexcept { static_cast<F*>(self)->~F(); },
+        };
+
+        alignas(ALIGNMENT) ubyte storage[STORAGE];
+        const Ops* ops = nullptr;
+
+    public:
+        Job() = default;
+
+        template <typename F>
+        requires (not std::same_as<std::decay_t<F>, Job>) and std::invocable<std::decay_t<F>&>
+        Job(F&& f) {
+            using T = std::decay_t<F>;
+            static_assert(sizeof(T) <= STORAGE, "Job callable is too large, capture less");
+            static_assert(alignof(T) <= ALIGNMENT, "Job callable is over-aligned");
+            static_assert(std::is_nothrow_move_constructible_v<T>, "Job callable must be nothrow movable");
+
+            new (storage) T(std::forward<F>(f));
+            ops = &OPS<T>;
+        }
+
+        Job(Job&& other) noexcept : ops(other.ops) {
+            if (ops) ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+        Job& operator=(Job&& other) noexcept {
+            if (this == &other) return *this;
+
+            reset();
+            ops = other.ops;
+            if (ops) ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+            return *this;
+        }
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+        ~Job() { reset(); }
+
+        none reset() {
+            if (not ops) return;
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+
+        explicit operator bool() const { return ops != nullptr; }
+
+        none operator()() { ops->invoke(storage); }
+    };
+
+    // Bounded lock-free multi-producer multi-consumer ring (Vyukov), values stored in place.
+    template <typename T, size CAPACITY>
+    class JobQueue {
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "JobQueue capacity must be a power of two");
+        inline static constexpr size MASK = CAPACITY - 1;
+
+        struct Cell {
+            std::atomic<size> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> cells = std::make_unique<Cell[]>(CAPACITY);
+        alignas(64) std::atomic<size> enqueue_pos = 0;
+        alignas(64) std::atomic<size> dequeue_pos = 0;
+
+    public:
+        JobQueue() {
+            for (size i = 0; i < CAPACITY; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool push(T&& value) {
+            size pos = enqueue_pos.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells[pos & MASK];
+                const size sequence = cell->sequence.load(std::memory_order_acquire);
+                const int64 diff = static_cast<int64>(sequence) - static_cast<int64>(pos);
+
+                if (diff == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }
+                else if (diff < 0) return false;
+                else pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& out) {
+            size pos = dequeue_pos.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells[pos & MASK];
+                const size sequence = cell->sequence.load(std::memory_order_acquire);
+                const int64 diff = static_cast<int64>(sequence) - static_cast<int64>(pos + 1);
+
+                if (diff == 0) {
+                    if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }
+                else if (diff < 0) return false;
+                else pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+
+            out = std::move(cell->value);
+            cell->sequence.store(pos + CAPACITY, std::memory_order_release);
+            return true;
+        }
+    };
+
+    enum class JobPriority : uint8 {
+        INTERACTIVE,    // Remeshing a chunk the player just edited
+        NEAR,           // Chunks around the player
+        FAR,            // Outer rings
+        BACKGROUND,     // Saving and other housekeeping
+    };
+    inline constexpr size JOB_PRIORITY_COUNT = 4;
+
+    // Lowers the calling thread below the render thread. Linux keeps a nice value per thread,
+    // and raising it needs no privileges.
+    inline none lower_current_thread_priority() {
+#if defined(_WIN32)
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+    }
+
+    // One pool for every background job. Each worker owns a lock-free ring per priority; jobs submitted from a
+    // worker go to its own ring, jobs from other threads are spread round-robin, and idle workers steal from
+    // the others before parking on an atomic wait. Higher classes are always looked at first.
+    // Workers are split in two groups: foreground workers only serve INTERACTIVE and NEAR at normal OS priority,
+    // background workers serve every class at reduced OS priority, so bulk work never competes with the render thread.
+    class JobSystem {
+        inline static constexpr size QUEUE_CAPACITY = 1024;
+        inline static constexpr int32 SPIN_COUNT = 64;
+
+        struct alignas(64) Worker {
+            JobQueue<Job, QUEUE_CAPACITY> queues[JOB_PRIORITY_COUNT];
+            std::thread thread;
+            size group = 0;
+        };
+
+        struct alignas(64) Group {
+            std::atomic<uint32> epoch = 0;
+            std::atomic<uint32> sleeping = 0;
+            JobPriority lowest = JobPriority::BACKGROUND;   // Lowest class this group serves
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        Group groups[2];
+        size group_count = 1;
+        std::atomic<size> next_queue = 0;
+        std::atomic<bool> stopping = false;
+
+        inline static thread_local JobSystem* current_system = nullptr;
+        inline static thread_local size current_index = 0;
+
+        bool find_job(size index, Job& job) {
+            const size lowest = static_cast<size>(groups[workers[index]->group].lowest);
+
+            for (size lane = 0; lane <= lowest; ++lane) {
+                if (workers[index]->queues[lane].pop(job)) return true;
+
+                for (size i = 1; i < workers.size(); ++i) {
+                    if (workers[(index + i) % workers.size()]->queues[lane].pop(job)) return true;
+                }
+            }
+            return false;
+        }
+
+        Group& group_for(JobPriority priority) {
+            return priority <= groups[0].lowest ? groups[0] : groups[group_count - 1];
+        }
+
+        none wake(JobPriority priority) {
+            Group& group = group_for(priority);
+            group.epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (group.sleeping.load(std::memory_order_seq_cst) != 0) group.epoch.notify_one();
+        }
+
+        none run_worker(size index) {
+            current_system = this;
+            current_index = index;
+
+            Group& group = groups[workers[index]->group];
+            if (workers[index]->group != 0) lower_current_thread_priority();
+            ThreadRegistry::register_thread(format{} << (workers[index]->group == 0 ? "Worker " : "Background Worker ") << index);
+
+            Job job;
+            while (true) {
+                bool found = false;
+                for (int32 spin = 0; spin < SPIN_COUNT and not found; ++spin) {
+                    found = find_job(index, job);
+                    if (not found) std::this_thread::yield();
+                }
+
+                if (found) {
+                    job();
+                    job.reset();
+                    continue;
+                }
+
+                // Read the epoch before the last look so a submit in between makes wait() return at once
+                const uint32 epoch = group.epoch.load(std::memory_order_seq_cst);
+                if (find_job(index, job)) {
+                    job();
+                    job.reset();
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire)) return;
+
+                group.sleeping.fetch_add(1, std::memory_order_seq_cst);
+                group.epoch.wait(epoch, std::memory_order_seq_cst);
+                group.sleeping.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        // Leaves one hardware thread to the main/render thread, half of the rest runs at low priority.
+        static size default_foreground_count() {
+            const size total = std::max<size>(std::thread::hardware_concurrency(), 2) - 1;
+            return total - total / 2;
+        }
+        static size default_background_count() {
+            const size total = std::max<size>(std::thread::hardware_concurrency(), 2) - 1;
+            return total / 2;
+        }
+
+        // Without background workers the foreground group serves every class.
+        explicit JobSystem(size foreground = default_foreground_count(), size background = default_background_count()) {
+            foreground = std::max<size>(foreground, 1);
+            group_count = background != 0 ? 2 : 1;
+            groups[0].lowest = background != 0 ? JobPriority::NEAR : JobPriority::BACKGROUND;
+            groups[1].lowest = JobPriority::BACKGROUND;
+
+            workers.reserve(foreground + background);
+            for (size i = 0; i < foreground + background; ++i) {
+                workers.push_back(std::make_unique<Worker>());
+                workers.back()->group = i < foreground ? 0 : 1;
+            }
+            for (size i = 0; i < workers.size(); ++i) workers[i]->thread = std::thread([this, i]() { run_worker(i); });
+        }
+
+        // Runs every job that is still queued, then joins the workers.
+        ~JobSystem() {
+            stopping.store(true, std::memory_order_release);
+            for (auto& group : groups) {
+                group.epoch.fetch_add(1, std::memory_order_seq_cst);
+                group.epoch.notify_all();
+            }
+
+            for (auto& worker : workers) worker->thread.join();
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        size worker_count() const {
+            return workers.size();
+        }
+
+        template <typename F>
+        none submit(JobPriority priority, F&& f) {
+            const size lane = static_cast<size>(priority);
+            Job job(std::forward<F>(f));
+
+            if (current_system == this and workers[current_index]->queues[lane].push(std::move(job))) {
+                wake(priority);
+                return;
+            }
+
+            // Every ring full means the producers are far ahead; back off until a worker catches up
+            while (true) {
+                const size start = next_queue.fetch_add(1, std::memory_order_relaxed);
+                for (size i = 0; i < workers.size(); ++i) {
+                    if (workers[(start + i) % workers.size()]->queues[lane].push(std::move(job))) {
+                        wake(priority);
+                        return;
+                    }
+                }
+                std::this_thread::yield();
             }
-            cv.notify_one();
         }
     };
 }
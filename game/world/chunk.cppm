@@ -1,16 +1,13 @@
 module;
 
-#include <godot_cpp/classes/array_mesh.hpp>
-#include <godot_cpp/classes/fast_noise_lite.hpp>
-#include <godot_cpp/classes/mesh_instance3d.hpp>
-#include <godot_cpp/variant/vector2.hpp>
-
 #include <includes.hpp>
 #include <mutex>
 #include <shared_mutex>
 #include <algorithm>
 #include <memory>
 #include <cmath>
+#include <chrono>
+#include <cstring>
 
 export module game.world.chunk;
 
@@ -21,21 +18,63 @@ import misc.list;
 import misc.range;
 import misc.number;
 import misc.pos;
+import misc.pool;
+import misc.arena;
 import game.block;
 import game.logger;
+import game.thread;
 import game.world.biome;
+import game.world.noise;
+import game.world.feature;
 import game.world.terrain;
-
-using namespace godot;
+import game.world.pending_writes;
+import game.world.scheduler;
 
 export namespace craftbuild {
-    struct MeshData {
+    // Laid out like the engine's Vector2, so the main thread copies a whole list into a PackedVector2Array
+    struct UV {
+        real u, v;
+    };
+
+    // Recycled through MeshDataPool once the main thread has uploaded it, so the lists keep their capacity
+    struct MeshData : RefCounted {
         List<Pos<real>> vertices;
         List<Pos<real>> normals;
         List<int32> indices;
-        List<Vector2> uvs;
-        List<Vector2> uvs_layer;
+        List<UV> uvs;
+        List<UV> uvs_layer;
         List<Pos<real>> collision_faces;
+
+        static none recycle(MeshData* data) {
+            Pool<MeshData>::release(data);
+        }
+
+        none reset() {
+            vertices.resize(0);
+            normals.resize(0);
+            indices.resize(0);
+            uvs.resize(0);
+            uvs_layer.resize(0);
+            collision_faces.resize(0);
+        }
+    };
+
+    using MeshDataPool = Pool<MeshData>;
+
+    // Time spent in each generation stage, in seconds; only measured when a caller asks for it.
+    struct GenerationTimings {
+        float64 terrain = 0.0;
+        float64 features = 0.0;
+        float64 commit = 0.0;
+        float64 merge = 0.0;
+
+        GenerationTimings& operator+=(const GenerationTimings& other) {
+            terrain += other.terrain;
+            features += other.features;
+            commit += other.commit;
+            merge += other.merge;
+            return *this;
+        }
     };
 
     struct FaceMask {
@@ -47,7 +86,59 @@ export namespace craftbuild {
         }
     };
 
-    class Chunk {
+    // A chunk's lifecycle in one word, so every transition is a single CAS and no flag is set apart from the others.
+    //   bits  0-15: flags
+    //   bits 16-39: revision, bumped by every change that needs a new mesh
+    //   bits 40-63: revision the latest mesh was built from; the chunk is dirty while the two differ
+    struct ChunkState {
+        enum Flag : uint64 {
+            GENERATED       = 1 << 0,
+            TERRAIN_QUEUED  = 1 << 1,
+            MESH_QUEUED     = 1 << 2,
+            MESH_READY      = 1 << 3,   // pending_mesh_data waits for the main thread
+            COLLISION_BUILT = 1 << 4,
+            EDITED          = 1 << 5,   // Next mesh job runs at JobPriority::INTERACTIVE
+            UNLOADING       = 1 << 6,   // Queued for removal, takes no new jobs
+            MODIFIED        = 1 << 7,   // Differs from what the seed generates, so it has to be stored
+        };
+
+        inline static constexpr uint64 REVISION_MASK = 0xFFFFFF;
+        inline static constexpr int32 REVISION_SHIFT = 16;
+        inline static constexpr int32 MESHED_SHIFT = 40;
+
+        uint64 word = 0;
+
+        bool has(uint64 flag) const {
+            return (word & flag) != 0;
+        }
+
+        none set(uint64 flag, bool on = true) {
+            word = on ? word | flag : word & ~flag;
+        }
+
+        uint32 revision() const {
+            return static_cast<uint32>((word >> REVISION_SHIFT) & REVISION_MASK);
+        }
+
+        uint32 meshed_revision() const {
+            return static_cast<uint32>((word >> MESHED_SHIFT) & REVISION_MASK);
+        }
+
+        bool dirty() const {
+            return revision() != meshed_revision();
+        }
+
+        none bump_revision() {
+            const uint64 next = (revision() + 1) & REVISION_MASK;
+            word = (word & ~(REVISION_MASK << REVISION_SHIFT)) | (next << REVISION_SHIFT);
+        }
+
+        none set_meshed_revision(uint32 value) {
+            word = (word & ~(REVISION_MASK << MESHED_SHIFT)) | ((static_cast<uint64>(value) & REVISION_MASK) << MESHED_SHIFT);
+        }
+    };
+
+    class Chunk : public RefCounted {
     public:
         inline static constexpr uint8 SIZE_X = 16;
         inline static constexpr uint8 SIZE_Y = 255;
@@ -58,19 +149,40 @@ export namespace craftbuild {
         Dict<Pos<uint8>, BlockStorageFull> complex_blocks;
         BlockStorage blocks[SIZE_X][SIZE_Y][SIZE_Z] = {};
 
-        MeshInstance3D* mesh_instance = nullptr;
-        Vector3i chunk_pos;
-        TrapezoidHeight height_provider{ VerticalAnchor::absolute(18), VerticalAnchor::absolute(38), 8 };
+        Pos<int32> chunk_pos{ 0, 0, 0 };
+
+        std::atomic<uint64> state = 0;
+
+        // Bumped when the chunk is unloaded or leaves the job range. Jobs remember the value they were queued
+        // with and give up at the next stage boundary once it changed.
+        std::atomic<uint32> epoch = 0;
+        inline static constexpr uint32 ANY_EPOCH = 0xFFFFFFFFu;   // Never cancelled (tools, save loading)
 
-        std::atomic<bool> generated = false;
-        std::atomic<bool> dirty = true;
-        std::atomic<bool> collision_built = false;
+        ChunkScheduler* scheduler = nullptr;    // Told when the chunk needs meshing again
 
-        std::atomic<bool> mesh_ready{ false };
-        Ptr<MeshData> pending_mesh_data = nullptr;
+        // Sides in the order +x, -x, +z, -z; side ^ 1 is the opposite one
+        inline static constexpr size NEIGHBOR_COUNT = 4;
+        inline static constexpr int32 NEIGHBOR_OFFSETS[NEIGHBOR_COUNT][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+        // Weak links to the loaded neighbours, kept by ChunkMap: set when either side is inserted, cleared before
+        // a chunk is erased. A linked chunk is reclaimed through Reclaimer, so read links under a Reclaimer::Guard.
+        std::atomic<Chunk*> neighbors[NEIGHBOR_COUNT] = {};
+
+        IPtr<MeshData> pending_mesh_data = nullptr;
         mutable std::mutex mesh_mutex;
         mutable std::shared_mutex data_mutex;
 
+        // Memory held outside the chunk object, recorded by the main thread when it uploads a mesh
+        std::atomic<size> mesh_bytes = 0;
+        std::atomic<size> collision_bytes = 0;
+
+        // Scheduler pass in which the chunk was last in range or edited; the memory budget evicts the lowest first
+        std::atomic<uint64> last_relevant = 0;
+
+        // Content changes since the chunk was created and the count its stored copy was written at; see unsaved()
+        std::atomic<uint32> edits = 0;
+        std::atomic<uint32> saved_edits = 0;
+
         ~Chunk() {
             std::lock_guard lock(mesh_mutex);
             if (pending_mesh_data) {
@@ -78,6 +190,194 @@ export namespace craftbuild {
             }
         }
 
+        // Called by IPtr in place of delete; parks the chunk in ChunkPool
+        static none recycle(Chunk* chunk) {
+            Pool<Chunk>::release(chunk);
+        }
+
+        // Puts the chunk back into the state new Chunk() leaves it in, keeping its allocations.
+        // Only for a chunk nothing else refers to.
+        none reset() {
+            block_ids.clear();
+            tag_ids.clear();
+            complex_blocks.clear();
+            std::memset(blocks, 0, sizeof(blocks));
+
+            chunk_pos = Pos<int32>(0, 0, 0);
+            state.store(0, std::memory_order_relaxed);
+            epoch.store(0, std::memory_order_relaxed);
+            scheduler = nullptr;
+            for (auto& link : neighbors) link.store(nullptr, std::memory_order_relaxed);
+            pending_mesh_data.clear();
+            mesh_bytes.store(0, std::memory_order_relaxed);
+            collision_bytes.store(0, std::memory_order_relaxed);
+            last_relevant.store(0, std::memory_order_relaxed);
+            edits.store(0, std::memory_order_relaxed);
+            saved_edits.store(0, std::memory_order_relaxed);
+        }
+
+        // Takes other's blocks and palettes, for a pooled chunk used as a snapshot. The block array is one memcpy,
+        // so other's lock is held only briefly.
+        none copy_content(const Chunk& other) {
+            std::shared_lock source(other.data_mutex);
+            std::unique_lock lock(data_mutex);
+            std::memcpy(blocks, other.blocks, sizeof(blocks));
+            block_ids = other.block_ids;
+            tag_ids = other.tag_ids;
+            complex_blocks = other.complex_blocks;
+        }
+
+        // Rough heap cost of the chunk object and its palettes; a Dict entry is counted as a node plus a bucket
+        size storage_bytes() const {
+            constexpr size ENTRY_OVERHEAD = 4 * sizeof(none*);
+            std::shared_lock lock(data_mutex);
+            return sizeof(Chunk)
+                + block_ids.size() * (ENTRY_OVERHEAD + sizeof(std::pair<uint8, uint32>))
+                + tag_ids.size() * (ENTRY_OVERHEAD + sizeof(std::pair<uint8, std::pair<uint32, size>>))
+                + complex_blocks.size() * (ENTRY_OVERHEAD + sizeof(std::pair<Pos<uint8>, BlockStorageFull>));
+        }
+
+        size memory_bytes() const {
+            return storage_bytes() + mesh_bytes.load(std::memory_order_relaxed) + collision_bytes.load(std::memory_order_relaxed);
+        }
+
+        ChunkState get_state() const {
+            return { state.load(std::memory_order_acquire) };
+        }
+
+        // Applies change to the current state until the CAS succeeds. change returns false to leave the state
+        // alone; before receives the state the change was applied to.
+        template <typename F>
+        bool transition(F&& change, ChunkState* before = nullptr) {
+            uint64 current = state.load(std::memory_order_acquire);
+            while (true) {
+                ChunkState next{ current };
+                if (not change(next)) return false;
+                if (state.compare_exchange_weak(current, next.word, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    if (before) before->word = current;
+                    return true;
+                }
+            }
+        }
+
+        bool is_generated() const {
+            return get_state().has(ChunkState::GENERATED);
+        }
+
+        none set_flag(uint64 flag, bool on) {
+            if (on) state.fetch_or(flag, std::memory_order_acq_rel);
+            else state.fetch_and(~flag, std::memory_order_acq_rel);
+        }
+
+        // Every content change that cannot be replayed from the seed: player edits and structure blocks merged in
+        // from a neighbour, whose pending writes are consumed by the merge.
+        none mark_modified() {
+            edits.fetch_add(1, std::memory_order_acq_rel);
+            set_flag(ChunkState::MODIFIED, true);
+        }
+
+        bool is_modified() const {
+            return get_state().has(ChunkState::MODIFIED);
+        }
+
+        // Modified and changed since its stored copy was written. Unmodified chunks are never stored: dropping
+        // one loses nothing, the terrain stage generates it again bit for bit.
+        bool unsaved() const {
+            const ChunkState current = get_state();
+            return current.has(ChunkState::GENERATED) and current.has(ChunkState::MODIFIED) and edits.load(std::memory_order_acquire) != saved_edits.load(std::memory_order_acquire);
+        }
+
+        // Read edits before serialising and pass it here once the write succeeded, so an edit made in between
+        // keeps the chunk unsaved.
+        none mark_saved(uint32 edits_at_write) {
+            saved_edits.store(edits_at_write, std::memory_order_release);
+        }
+
+        // For chunks read from a save: generated, never meshed. Only modified chunks are stored, so it is modified too.
+        none mark_loaded() {
+            transition([](ChunkState& s) {
+                s.set(ChunkState::GENERATED | ChunkState::MODIFIED);
+                s.set(ChunkState::MESH_READY | ChunkState::COLLISION_BUILT, false);
+                s.bump_revision();
+                return true;
+            });
+        }
+
+        // Every change that needs a new mesh goes through here. Edits made while a mesh is being built bump the
+        // revision past the one that mesh records, so they are never lost.
+        none mark_dirty(bool edited = false) {
+            ChunkState before;
+            transition([edited](ChunkState& s) {
+                s.bump_revision();
+                if (edited) s.set(ChunkState::EDITED);
+                return true;
+            }, &before);
+
+            if (not before.dirty() and scheduler) scheduler->request(Pos<int32>(chunk_pos.x, 0, chunk_pos.z));
+        }
+
+        // Caller holds a Reclaimer::Guard for as long as it uses the result
+        Chunk* neighbor(size side) const {
+            return neighbors[side].load(std::memory_order_acquire);
+        }
+
+        // Visits every linked neighbour as f(side, chunk)
+        template <typename F>
+        none for_each_neighbor(F&& f) const {
+            Reclaimer::Guard guard;
+            for (auto side : range<size>(NEIGHBOR_COUNT)) {
+                if (Chunk* chunk = neighbor(side)) f(side, *chunk);
+            }
+        }
+
+        // The try_queue_* calls claim the job for the caller; they replace the set of chunks with a job in flight.
+        bool try_queue_terrain() {
+            return transition([](ChunkState& s) {
+                if (s.has(ChunkState::GENERATED | ChunkState::TERRAIN_QUEUED | ChunkState::UNLOADING)) return false;
+                s.set(ChunkState::TERRAIN_QUEUED);
+                return true;
+            });
+        }
+
+        none finish_terrain() {
+            set_flag(ChunkState::TERRAIN_QUEUED, false);
+        }
+
+        // revision is what the mesh job will be built from; interactive is the EDITED flag, which is consumed here.
+        bool try_queue_mesh(uint32& revision, bool& interactive) {
+            ChunkState before;
+            const bool queued = transition([](ChunkState& s) {
+                if (not s.has(ChunkState::GENERATED) or s.has(ChunkState::MESH_QUEUED | ChunkState::UNLOADING) or not s.dirty()) return false;
+                s.set(ChunkState::MESH_QUEUED);
+                s.set(ChunkState::EDITED, false);
+                return true;
+            }, &before);
+
+            revision = before.revision();
+            interactive = before.has(ChunkState::EDITED);
+            return queued;
+        }
+
+        none finish_mesh(uint32 revision, bool built) {
+            transition([revision, built](ChunkState& s) {
+                s.set(ChunkState::MESH_QUEUED, false);
+                if (built) s.set_meshed_revision(revision);
+                return true;
+            });
+        }
+
+        bool try_mark_unloading() {
+            return transition([](ChunkState& s) {
+                if (s.has(ChunkState::UNLOADING)) return false;
+                s.set(ChunkState::UNLOADING);
+                return true;
+            });
+        }
+
+        bool has_job_in_flight() const {
+            return get_state().has(ChunkState::TERRAIN_QUEUED | ChunkState::MESH_QUEUED);
+        }
+
         static uint32 column_seed(int32 seed, int32 x, int32 z) {
             uint32 h = static_cast<uint32>(seed);
             h ^= static_cast<uint32>(x) + 0x9e3779b9u + (h << 6) + (h >> 2);
@@ -106,19 +406,19 @@ export namespace craftbuild {
             };
         }
 
-        static Biome select_biome_at(int32 wx, int32 wz, Ref<FastNoiseLite> noise, size biome_count) {
+        static Biome select_biome_at(int32 wx, int32 wz, const Noise& noise, size biome_count) {
             if (biome_count == 0) return { 0.01f, 40.0f, 0.4f, 4.0f, 60.0f, 0 };
 
-            const float32 biome_noise_val = noise->get_noise_2d(
-                static_cast<real_t>(wx + 10000) * 0.005f,
-                static_cast<real_t>(wz + 10000) * 0.005f
+            const float32 biome_noise_val = noise.get_noise_2d(
+                static_cast<real>(wx + 10000) * 0.005f,
+                static_cast<real>(wz + 10000) * 0.005f
             );
             const float32 normalized = (biome_noise_val + 1.0f) * 0.5f;
             const size biome_idx = std::clamp(static_cast<size>(normalized * biome_count), static_cast<size>(0), biome_count - 1);
             return BiomeRegistry::get_biome(biome_idx);
         }
 
-        static Biome get_blended_biome(int32 wx, int32 wz, Ref<FastNoiseLite> noise, size biome_count) {
+        static Biome get_blended_biome(int32 wx, int32 wz, const Noise& noise, size biome_count) {
             if (biome_count <= 1) return select_biome_at(wx, wz, noise, biome_count);
 
             static constexpr int32 BLEND_CELL_SIZE = 96;
@@ -147,8 +447,19 @@ export namespace craftbuild {
         none set_block(const Pos<uint8>& pos, const Str& block) {
 			set_block(pos, BlockRegistry::get_id(block));
         }
-        none set_block(const Pos<uint8>& pos, uint32 block_id) {
-            std::unique_lock lock(data_mutex);
+        template <bool lock = true>
+        none set_block(const Pos<uint8>& pos, uint32 block_id);
+
+        template<>
+        none set_block<true>(const Pos<uint8>& pos, uint32 block_id) {
+            {
+                std::unique_lock lock(data_mutex);
+                set_block<false>(pos, block_id);
+            }
+            mark_modified();
+        }
+        template<>
+        none set_block<false>(const Pos<uint8>& pos, uint32 block_id) {
             if (block_ids.size() >= 256) {
                 complex_blocks.emplace(pos, BlockStorageFull(block_id, 0, 0));
                 return;
@@ -249,37 +560,174 @@ export namespace craftbuild {
             return tag_ids.find(blocks[pos.x][pos.y][pos.z].tag) != tag_ids.end() ? tag_ids.at(blocks[pos.x][pos.y][pos.z].tag) : std::make_pair(0U, (size)0);
         }
 
-        none generate_terrain(int32 seed, Ref<FastNoiseLite> noise) {
-            const uint32 AIR     = BlockRegistry::get_id("Air");
-            const uint32 GRASS   = BlockRegistry::get_id("Grass Block");
-            const uint32 DIRT    = BlockRegistry::get_id("Dirt");
-            const uint32 STONE   = BlockRegistry::get_id("Stone");
-            const uint32 BEDROCK = BlockRegistry::get_id("Bedrock");
+        // Scratch copy of a chunk used while generating; no locking until it is committed.
+        struct ProtoChunk {
+            inline static constexpr int32 SIZE_X = Chunk::SIZE_X;
+            inline static constexpr int32 SIZE_Y = Chunk::SIZE_Y;
+            inline static constexpr int32 SIZE_Z = Chunk::SIZE_Z;
+
+            BlockStorage (*blocks)[Chunk::SIZE_Y][Chunk::SIZE_Z];     // Zeroed scratch from the caller's arena
+            Dict<uint8, uint32> block_ids;
+            Dict<uint8, std::pair<uint32, size>> tag_ids;
+            Dict<Pos<uint8>, BlockStorageFull> complex_blocks;
+
+            int32 chunk_x = 0;
+            int32 chunk_z = 0;
+            uint32 air = 0;
+            Dict<Pos<int32>, std::vector<PendingBlock>> outgoing;
+
+            ProtoChunk(int32 chunk_x, int32 chunk_z, uint32 air, Arena& arena) : chunk_x(chunk_x), chunk_z(chunk_z), air(air) {
+                blocks = arena.allocate_array<BlockStorage[Chunk::SIZE_Y][Chunk::SIZE_Z]>(Chunk::SIZE_X);
+                std::memset(blocks, 0, sizeof(BlockStorage) * Chunk::SIZE_X * Chunk::SIZE_Y * Chunk::SIZE_Z);
+            }
+
+            bool contains(int32 x, int32 y, int32 z) const {
+                return x >= 0 and x < SIZE_X and y >= 0 and y < SIZE_Y and z >= 0 and z < SIZE_Z;
+            }
+
+            uint32 get_block(int32 x, int32 y, int32 z) const {
+                if (not contains(x, y, z)) return 0;
 
-            auto new_blocks = std::make_unique<BlockStorage[][SIZE_Y][SIZE_Z]>(SIZE_X);
-            Dict<uint8, uint32> new_block_ids;
-            Dict<uint8, std::pair<uint32, size>> new_tag_ids;
-            Dict<Pos<uint8>, BlockStorageFull> new_complex_blocks;
+                const Pos<uint8> pos{ (uint8)x, (uint8)y, (uint8)z };
+                auto complex = complex_blocks.find(pos);
+                if (complex != complex_blocks.end()) return complex->second.block_id;
 
-            auto add_block_unlocked = [&](const Pos<uint8>& pos, uint32 block_id) {
-                if (new_block_ids.size() >= 256) {
-                    new_complex_blocks.emplace(pos, BlockStorageFull(block_id, 0, 0));
+                auto it = block_ids.find(blocks[x][y][z].block_id);
+                return it != block_ids.end() ? it->second : 0;
+            }
+
+            none set_block(int32 x, int32 y, int32 z, uint32 block_id) {
+                if (not contains(x, y, z)) return;
+
+                const Pos<uint8> pos{ (uint8)x, (uint8)y, (uint8)z };
+                if (block_ids.size() >= 256) {
+                    complex_blocks.insert_or_assign(pos, BlockStorageFull(block_id, 0, 0));
                     return;
                 }
 
-                auto it = std::find_if(new_block_ids.begin(), new_block_ids.end(), [block_id](const auto& pair) {
+                auto it = std::find_if(block_ids.begin(), block_ids.end(), [block_id](const auto& pair) {
                     return pair.second == block_id;
                 });
-                if (it != new_block_ids.end()) {
-                    new_blocks[pos.x][pos.y][pos.z].block_id = it->first;
+                if (it != block_ids.end()) {
+                    blocks[x][y][z].block_id = it->first;
                     return;
                 }
 
-                const uint8 local_id = static_cast<uint8>(new_block_ids.size());
-                new_blocks[pos.x][pos.y][pos.z].block_id = local_id;
-                new_block_ids.emplace(local_id, block_id);
+                const uint8 local_id = static_cast<uint8>(block_ids.size());
+                blocks[x][y][z].block_id = local_id;
+                block_ids.emplace(local_id, block_id);
+            }
+
+            int32 surface_y(int32 x, int32 z) const {
+                if (not contains(x, 0, z)) return -1;
+                for (auto y : range<int32>(SIZE_Y - 1, -1)) {
+                    if (get_block(x, y, z) != air) return y;
+                }
+                return -1;
+            }
+
+            // Like set_block(), but blocks outside this chunk are recorded for the chunk they belong to. Those only
+            // ever fill air: the neighbour may already be generated and edited by the player, and it has to come out
+            // the same whichever of the two was generated first.
+            none place_block(int32 x, int32 y, int32 z, uint32 block_id, WriteMode mode) {
+                if (y < 0 or y >= SIZE_Y) return;
+
+                if (contains(x, y, z)) {
+                    if (should_write(get_block(x, y, z), mode, air)) set_block(x, y, z, block_id);
+                    return;
+                }
+
+                const int32 global_x = chunk_x * SIZE_X + x;
+                const int32 global_z = chunk_z * SIZE_Z + z;
+                const int32 target_x = static_cast<int32>(std::floor(static_cast<float64>(global_x) / SIZE_X));
+                const int32 target_z = static_cast<int32>(std::floor(static_cast<float64>(global_z) / SIZE_Z));
+
+                outgoing[Pos<int32>(target_x, 0, target_z)].push_back({
+                    static_cast<uint8>(global_x - target_x * SIZE_X),
+                    static_cast<uint8>(y),
+                    static_cast<uint8>(global_z - target_z * SIZE_Z),
+                    WriteMode::IF_AIR,
+                    block_id
+                });
+            }
+
+            none apply(const std::vector<PendingBlock>& incoming) {
+                for (const auto& write : incoming) {
+                    if (should_write(get_block(write.x, write.y, write.z), write.mode, air)) set_block(write.x, write.y, write.z, write.block_id);
+                }
+            }
+
+            std::vector<PendingBatch> take_outgoing() {
+                std::vector<PendingBatch> batches;
+                batches.reserve(outgoing.size());
+                for (auto& [target, writes] : outgoing) batches.push_back({ target, std::move(writes) });
+                outgoing.clear();
+                return batches;
+            }
+        };
+
+        // Palette independent FNV-1a hash of every block id, used to pin world generation output.
+        uint64 content_hash() const {
+            std::shared_lock lock(data_mutex);
+
+            uint64 hash = 0xcbf29ce484222325ull;
+            for (auto x : range<uint8>(SIZE_X)) {
+                for (auto y : range<uint8>(SIZE_Y)) {
+                    for (auto z : range<uint8>(SIZE_Z)) {
+                        hash ^= get_block<false>({ x, y, z });
+                        hash *= 0x100000001b3ull;
+                    }
+                }
+            }
+            return hash;
+        }
+
+        // Merges structure blocks sent by a neighbour that was generated after this chunk.
+        none apply_pending(const std::vector<PendingBlock>& incoming) {
+            const uint32 AIR = BlockRegistry::get_id("Air");
+            {
+                std::unique_lock lock(data_mutex);
+                for (const auto& write : incoming) {
+                    const Pos<uint8> pos{ write.x, write.y, write.z };
+                    if (should_write(get_block<false>(pos), write.mode, AIR)) set_block<false>(pos, write.block_id);
+                }
+            }
+            mark_modified();
+            mark_dirty();
+        }
+
+        none cancel_jobs() {
+            epoch.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        bool is_stale(uint32 ticket) const {
+            return ticket != ANY_EPOCH and epoch.load(std::memory_order_acquire) != ticket;
+        }
+
+        // Returns the structure blocks that fell outside this chunk, grouped by target chunk.
+        // A stale ticket stops before the commit and leaves the chunk ungenerated; once committed the
+        // outgoing writes are always returned so neighbours never lose their part of a structure.
+        std::vector<PendingBatch> generate_terrain(int32 seed, const Noise& noise, PendingWrites& pending, GenerationTimings* timings = nullptr, uint32 ticket = ANY_EPOCH) {
+            if (is_stale(ticket)) return {};
+
+            auto stage_start = std::chrono::steady_clock::now();
+            auto lap = [&](float64 GenerationTimings::* stage) {
+                if (not timings) return;
+                const auto now = std::chrono::steady_clock::now();
+                timings->*stage += std::chrono::duration<float64>(now - stage_start).count();
+                stage_start = now;
             };
 
+            const uint32 AIR     = BlockRegistry::get_id("Air");
+            const uint32 GRASS   = BlockRegistry::get_id("Grass Block");
+            const uint32 DIRT    = BlockRegistry::get_id("Dirt");
+            const uint32 STONE   = BlockRegistry::get_id("Stone");
+            const uint32 BEDROCK = BlockRegistry::get_id("Bedrock");
+
+            Arena& arena = Arena::local();
+            Arena::Scope scratch(arena);
+            ProtoChunk proto(chunk_pos.x, chunk_pos.z, AIR, arena);
+
             const size biome_count = BiomeRegistry::registry.size();
             for (auto x : range<uint8>(SIZE_X)) {
                 for (auto z : range<uint8>(SIZE_Z)) {
@@ -288,11 +736,11 @@ export namespace craftbuild {
 
                     const Biome current_biome = get_blended_biome(global_x, global_z, noise, biome_count);
 
-                    float32 base_noise = noise->get_noise_2d(static_cast<real_t>(global_x) * current_biome.base_noise, static_cast<real_t>(global_z) * current_biome.base_noise);
+                    float32 base_noise = noise.get_noise_2d(static_cast<real>(global_x) * current_biome.base_noise, static_cast<real>(global_z) * current_biome.base_noise);
                     float32 base_elevation = ((base_noise + 1.0f) * 0.5f) * current_biome.base_height;
                     float32 detail_elevation = 0.0f;
                     if (current_biome.detail_noise > 0.0f and current_biome.detail_height > 0.0f) {
-                        const float32 detail_noise = noise->get_noise_2d(static_cast<real_t>(global_x) * current_biome.detail_noise, static_cast<real_t>(global_z) * current_biome.detail_noise);
+                        const float32 detail_noise = noise.get_noise_2d(static_cast<real>(global_x) * current_biome.detail_noise, static_cast<real>(global_z) * current_biome.detail_noise);
                         detail_elevation = detail_noise * current_biome.detail_height;
                     }
                     float32 terrain_base_y = current_biome.min_height + base_elevation + detail_elevation;
@@ -301,14 +749,14 @@ export namespace craftbuild {
 
                     for (auto y : range<int16>(SIZE_Y - 1, -1)) {
                         if (y == 0) {
-                            add_block_unlocked({ x, (uint8)y, z }, BEDROCK);
+                            proto.set_block(x, y, z, BEDROCK);
                             continue;
                         }
 
-                        float32 noise_3d = noise->get_noise_3d(
-                            static_cast<real_t>(global_x) * 0.2f,
-                            static_cast<real_t>(y) * 0.3f,
-                            static_cast<real_t>(global_z) * 0.2f
+                        float32 noise_3d = noise.get_noise_3d(
+                            static_cast<real>(global_x) * 0.2f,
+                            static_cast<real>(y) * 0.3f,
+                            static_cast<real>(global_z) * 0.2f
                         );
 
                         float32 density = terrain_base_y - static_cast<float32>(y) + (noise_3d * 25.0f);
@@ -327,25 +775,62 @@ export namespace craftbuild {
                         }
                         else solid_depth = -1;
 
-                        add_block_unlocked({ x, (uint8)y, z }, block_id);
+                        proto.set_block(x, y, z, block_id);
                     }
                 }
             }
 
-            {
-                std::unique_lock lock(data_mutex);
-                std::memcpy(blocks, new_blocks.get(), sizeof(blocks));
-                block_ids = std::move(new_block_ids);
-                tag_ids = std::move(new_tag_ids);
-                complex_blocks = std::move(new_complex_blocks);
-            }
+            lap(&GenerationTimings::terrain);
+
+            // Features only touch the scratch copy and are seeded from the chunk alone,
+            // so the result does not depend on thread count or generation order.
+            if (is_stale(ticket)) return {};
+
+            const WorldGenerationContext context{ 0, SIZE_Y };
+            const uint32 chunk_seed = column_seed(seed, chunk_pos.x, chunk_pos.z);
+            FeatureRegistry::place_ores(proto, chunk_seed, context);
+            FeatureRegistry::place_structures(proto, chunk_seed);
+            lap(&GenerationTimings::features);
+
+            if (is_stale(ticket)) return {};
+
+            // Modified, and so stored instead of generated again, when it took blocks from a neighbour or sends some
+            // out: generating it again would send them a second time, into a neighbour that may have changed since.
+            const bool sends = not proto.outgoing.empty();
+            pending.drain(Pos<int32>(chunk_pos.x, 0, chunk_pos.z), [&](const std::vector<PendingBlock>& incoming) {
+                proto.apply(incoming);
 
-            generated.store(true, std::memory_order_release);
-            dirty.store(true, std::memory_order_release);
+                {
+                    std::unique_lock lock(data_mutex);
+                    std::memcpy(blocks, proto.blocks, sizeof(blocks));
+                    block_ids = std::move(proto.block_ids);
+                    tag_ids = std::move(proto.tag_ids);
+                    complex_blocks = std::move(proto.complex_blocks);
+                }
+
+                const bool modified = sends or not incoming.empty();
+                transition([modified](ChunkState& s) {
+                    s.set(ChunkState::GENERATED);
+                    if (modified) s.set(ChunkState::MODIFIED);
+                    s.bump_revision();
+                    return true;
+                });
+                if (modified) edits.fetch_add(1, std::memory_order_acq_rel);
+            });
+            lap(&GenerationTimings::commit);
+
+            return proto.take_outgoing();
         }
 
-        none generate_mesh(Ptr<Chunk> neighbors[4]) {
-            Ptr<MeshData> data = new MeshData();
+        // Returns false when the ticket went stale. Does not touch the revisions; see try_queue_mesh()/finish_mesh().
+        bool generate_mesh(uint32 ticket = ANY_EPOCH) {
+            if (is_stale(ticket)) return false;
+
+            Reclaimer::Guard guard;
+            Chunk* sides[NEIGHBOR_COUNT];
+            for (auto i : range<size>(NEIGHBOR_COUNT)) sides[i] = neighbor(i);
+
+            IPtr<MeshData> data = MeshDataPool::acquire();
             auto& vertices        = data.value().vertices;
             auto& normals         = data.value().normals;
             auto& indices         = data.value().indices;
@@ -363,17 +848,17 @@ export namespace craftbuild {
             indices.expect(6144);
             collision_faces.expect(6144);
 
-            std::vector<std::shared_mutex*> mutexes_to_lock;
-            mutexes_to_lock.push_back(&data_mutex);
-            for (auto i : range<int>(4)) if (neighbors[i]) mutexes_to_lock.push_back(&neighbors[i].value().data_mutex);
-
-            std::sort(mutexes_to_lock.begin(), mutexes_to_lock.end());
-            mutexes_to_lock.erase(std::unique(mutexes_to_lock.begin(), mutexes_to_lock.end()), mutexes_to_lock.end());
+            // Address order, so two meshes sharing a neighbour never wait on each other
+            std::shared_mutex* mutexes_to_lock[NEIGHBOR_COUNT + 1];
+            size lock_count = 0;
+            mutexes_to_lock[lock_count++] = &data_mutex;
+            for (auto* side : sides) if (side) mutexes_to_lock[lock_count++] = &side->data_mutex;
 
-            std::vector<std::unique_ptr<std::shared_lock<std::shared_mutex>>> locks;
-            for (auto* m : mutexes_to_lock) locks.push_back(std::make_unique<std::shared_lock<std::shared_mutex>>(*m));
+            std::sort(mutexes_to_lock, mutexes_to_lock + lock_count);
+            lock_count = static_cast<size>(std::unique(mutexes_to_lock, mutexes_to_lock + lock_count) - mutexes_to_lock);
 
-            dirty.store(false, std::memory_order_release);
+            std::shared_lock<std::shared_mutex> locks[NEIGHBOR_COUNT + 1];
+            for (auto i : range<size>(lock_count)) locks[i] = std::shared_lock(*mutexes_to_lock[i]);
 
             auto transparent_or_air = [&](int bx, int by, int bz) -> bool {
                 if (by < 0 or by >= Chunk::SIZE_Y) return true;
@@ -388,14 +873,14 @@ export namespace craftbuild {
                     else if (bz >= Chunk::SIZE_Z) nid = 2;
                     else if (bz < 0)              nid = 3;
 
-                    Ptr<Chunk> neighbor = neighbors[nid];
-                    if (not neighbor or not neighbor.value().generated.load(std::memory_order_acquire)) return true;
+                    const Chunk* side = sides[nid];
+                    if (not side or not side->is_generated()) return true;
 
                     uint8 lx = (uint8)((bx % Chunk::SIZE_X + Chunk::SIZE_X) % Chunk::SIZE_X);
                     uint8 lz = (uint8)((bz % Chunk::SIZE_Z + Chunk::SIZE_Z) % Chunk::SIZE_Z);
 
-                    id = neighbor.value().get_block<false>({ lx, (uint8)by, lz });
-                    tag = neighbor.value().get_tag<false>({ lx, (uint8)by, lz });
+                    id = side->get_block<false>({ lx, (uint8)by, lz });
+                    tag = side->get_tag<false>({ lx, (uint8)by, lz });
                 }
                 else {
                     id = get_block<false>({ (uint8)bx, (uint8)by, (uint8)bz });
@@ -411,7 +896,7 @@ export namespace craftbuild {
             auto get_block_layer = [&](int bx, int by, int bz, Face face) -> int {
                 uint32 id = get_block<false>({ (uint8)bx, (uint8)by, (uint8)bz });
                 if (id == AIR) return -1;
-                Ptr<Block> block = BlockRegistry::get_block(id);
+                View<Block> block = BlockRegistry::get_block(id);
                 if (not block) return -1;
                 return block.value().get_texture_layer(face);
             };
@@ -420,11 +905,16 @@ export namespace craftbuild {
             const Face front_faces[3] = { Face::RIGHT, Face::TOP,    Face::FRONT };
             const Face back_faces[3] =  { Face::LEFT,  Face::BOTTOM, Face::BACK  };
 
-            List<FaceMask> mask;
-            mask.resize(Chunk::SIZE_Y * std::max(Chunk::SIZE_X, Chunk::SIZE_Z));
+            Arena& arena = Arena::local();
+            Arena::Scope scratch(arena);
+            const size mask_size = Chunk::SIZE_Y * std::max(Chunk::SIZE_X, Chunk::SIZE_Z);
+            List<FaceMask> mask = arena.list<FaceMask>(mask_size);
+            mask.resize(mask_size);
 
             uint64 vertex_offset = 0;
             for (auto d : range<int>(3)) {
+                if (is_stale(ticket)) return false;
+
                 const int u = (d + 1) % 3;
                 const int v = (d + 2) % 3;
 
@@ -490,14 +980,14 @@ export namespace craftbuild {
                             Pos<float32> p2(start[0] + du[0] + dv[0], start[1] + du[1] + dv[1], start[2] + du[2] + dv[2]);
                             Pos<float32> p3(start[0] + dv[0], start[1] + dv[1], start[2] + dv[2]);
 
-                            auto get_uv = [&](const Pos<float32>& p) -> Vector2 {
+                            auto get_uv = [&](const Pos<float32>& p) -> UV {
                                 const float32 dx = p.x - p0.x;
                                 const float32 dy = p.y - p0.y;
                                 const float32 dz = p.z - p0.z;
 
-                                if (d == 0)      return Vector2(current_face.back_face ? height - dz : dz, width - dy);
-                                else if (d == 1) return Vector2(dx, current_face.back_face ? height - dz : dz);
-                                else             return Vector2(current_face.back_face ? width - dx : dx, height -dy);
+                                if (d == 0)      return { current_face.back_face ? height - dz : dz, width - dy };
+                                else if (d == 1) return { dx, current_face.back_face ? height - dz : dz };
+                                else             return { current_face.back_face ? width - dx : dx, height -dy };
                             };
 
                             if (not current_face.back_face) {
@@ -519,14 +1009,14 @@ export namespace craftbuild {
                                 uvs.append(get_uv(p1));
                             }
 
-                            Vector3 normal(0, 0, 0);
+                            Pos<real> normal(0, 0, 0);
                             if      (d == 0) normal.x = current_face.back_face ? -1.0f : 1.0f;
                             else if (d == 1) normal.y = current_face.back_face ? -1.0f : 1.0f;
                             else if (d == 2) normal.z = current_face.back_face ? -1.0f : 1.0f;
 
                             for (auto n : range<int>(4)) normals.append(normal);
 
-                            Vector2 layer_uv(static_cast<float>(current_face.layer), 0.0f);
+                            const UV layer_uv{ static_cast<real>(current_face.layer), 0.0f };
                             for (auto n : range<int>(4)) uvs_layer.append(layer_uv);
 
                             indices.append(vertex_offset + 0); indices.append(vertex_offset + 2); indices.append(vertex_offset + 1);
@@ -554,10 +1044,14 @@ export namespace craftbuild {
             {
                 std::lock_guard lock(mesh_mutex);
                 pending_mesh_data = data;
+                set_flag(ChunkState::MESH_READY, true);
             }
 
-            mesh_ready.store(true, std::memory_order_release);
-            dirty.store(false, std::memory_order_release);
+            return true;
         }
     };
+
+    // Chunks come and go in bursts as the player moves; recycling them keeps unloading off the allocator.
+    // The scheduler thread trims the spares between ticks.
+    using ChunkPool = Pool<Chunk>;
 }
@@ -0,0 +1,320 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <bit>
+#include <algorithm>
+
+export module game.world.chunk_map;
+
+import misc.ptr;
+import misc.pos;
+import misc.range;
+import misc.number;
+import game.thread;
+import game.world.chunk;
+
+export namespace craftbuild {
+    // Chunk index shared by the main thread, the scheduler and every worker. Keys are split over 64 shards,
+    // each an open-addressing table with linear probing. Lookups take no lock: they probe under a
+    // Reclaimer::Guard, and writers (one at a time per shard) never free a node or table a reader may still
+    // be looking at, they retire it instead. The map also keeps each chunk's neighbour links up to date: a
+    // writer locks the shard of its chunk and those of the four neighbours, so links only change between
+    // chunks whose shards are all held.
+    class ChunkMap {
+        inline static constexpr size SHARD_BITS = 6;
+        inline static constexpr size SHARD_COUNT = size(1) << SHARD_BITS;
+        inline static constexpr size MIN_CAPACITY = 16;
+
+        struct Node {
+            Pos<int32> pos;
+            IPtr<Chunk> chunk;
+        };
+
+        struct Table {
+            size capacity;
+            std::unique_ptr<std::atomic<Node*>[]> slots;
+
+            explicit Table(size capacity) : capacity(capacity), slots(new std::atomic<Node*>[capacity]) {
+                for (size i = 0; i < capacity; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        };
+
+        struct alignas(64) Shard {
+            std::atomic<Table*> table = nullptr;
+            std::mutex write_mutex;
+            size live = 0;          // Under write_mutex
+            size used = 0;          // Live plus tombstones, under write_mutex
+        };
+
+        inline static Node tombstone_node;
+        inline static Node* const TOMBSTONE = &tombstone_node;
+
+        Shard shards[SHARD_COUNT];
+        std::atomic<size> total = 0;
+
+        // splitmix64 finaliser over both coordinates; the top bits pick the shard, the low bits the slot
+        static uint64 hash(const Pos<int32>& pos) {
+            uint64 h = (static_cast<uint64>(static_cast<uint32>(pos.x)) << 32) | static_cast<uint32>(pos.z);
+            h += 0x9e3779b97f4a7c15ull;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+            return h ^ (h >> 31);
+        }
+
+        static Pos<int32> neighbor_pos(const Pos<int32>& pos, size side) {
+            return Pos<int32>(pos.x + Chunk::NEIGHBOR_OFFSETS[side][0], 0, pos.z + Chunk::NEIGHBOR_OFFSETS[side][1]);
+        }
+
+        static size shard_index(uint64 h) {
+            return h >> (64 - SHARD_BITS);
+        }
+
+        static bool same(const Pos<int32>& a, const Pos<int32>& b) {
+            return a.x == b.x and a.z == b.z;
+        }
+
+        Shard& shard_for(uint64 h) {
+            return shards[shard_index(h)];
+        }
+
+        const Shard& shard_for(uint64 h) const {
+            return shards[shard_index(h)];
+        }
+
+        // The write_mutex of the shard of pos and of its neighbours' shards, each once, locked in array (and so
+        // address) order. Two writers then never wait on each other in a cycle, and no link into the area changes
+        // while it is held.
+        class AreaLock {
+            Shard* shards;
+            size indices[Chunk::NEIGHBOR_COUNT + 1];
+            size count = 0;
+
+        public:
+            AreaLock(ChunkMap& map, const Pos<int32>& pos) : shards(map.shards) {
+                indices[count++] = shard_index(hash(pos));
+                for (auto side : range<size>(Chunk::NEIGHBOR_COUNT)) {
+                    const size index = shard_index(hash(neighbor_pos(pos, side)));
+                    if (std::find(indices, indices + count, index) == indices + count) indices[count++] = index;
+                }
+                std::sort(indices, indices + count);
+                for (auto i : range<size>(count)) shards[indices[i]].write_mutex.lock();
+            }
+
+            ~AreaLock() {
+                for (auto i : range<size>(count)) shards[indices[i]].write_mutex.unlock();
+            }
+
+            AreaLock(const AreaLock&) = delete;
+            AreaLock& operator=(const AreaLock&) = delete;
+        };
+
+        // Caller holds a guard or the shard's write_mutex
+        static Node* probe(const Table* table, uint64 h, const Pos<int32>& pos) {
+            if (not table) return nullptr;
+
+            const size mask = table->capacity - 1;
+            for (size i = 0, slot = h & mask; i < table->capacity; ++i, slot = (slot + 1) & mask) {
+                Node* node = table->slots[slot].load(std::memory_order_acquire);
+                if (not node) return nullptr;
+                if (node != TOMBSTONE and same(node->pos, pos)) return node;
+            }
+            return nullptr;
+        }
+
+        // Caller holds write_mutex. Rebuilds the table without tombstones when the next insert would fill it past 70%.
+        none reserve_one(Shard& shard) {
+            Table* table = shard.table.load(std::memory_order_relaxed);
+            if (table and (shard.used + 1) * 10 <= table->capacity * 7) return;
+
+            const size capacity = std::max(MIN_CAPACITY, std::bit_ceil((shard.live + 1) * 2));
+            Table* fresh = new Table(capacity);
+            if (table) {
+                for (size i = 0; i < table->capacity; ++i) {
+                    Node* node = table->slots[i].load(std::memory_order_relaxed);
+                    if (not node or node == TOMBSTONE) continue;
+
+                    size slot = hash(node->pos) & (capacity - 1);
+                    while (fresh->slots[slot].load(std::memory_order_relaxed)) slot = (slot + 1) & (capacity - 1);
+                    fresh->slots[slot].store(node, std::memory_order_relaxed);
+                }
+            }
+
+            shard.table.store(fresh, std::memory_order_release);
+            shard.used = shard.live;
+            Reclaimer::retire(table);
+        }
+
+        // Caller holds an AreaLock on pos
+        none link(const Pos<int32>& pos, Chunk* chunk) {
+            for (auto side : range<size>(Chunk::NEIGHBOR_COUNT)) {
+                const Pos<int32> other_pos = neighbor_pos(pos, side);
+                const uint64 h = hash(other_pos);
+                Node* other = probe(shard_for(h).table.load(std::memory_order_relaxed), h, other_pos);
+                if (not other) continue;
+
+                chunk->neighbors[side].store(&other->chunk.value(), std::memory_order_release);
+                other->chunk.value().neighbors[side ^ 1].store(chunk, std::memory_order_release);
+            }
+        }
+
+        // Caller holds an AreaLock on the chunk's position, or every shard's write_mutex
+        static none unlink(Chunk* chunk) {
+            for (auto side : range<size>(Chunk::NEIGHBOR_COUNT)) {
+                Chunk* other = chunk->neighbors[side].exchange(nullptr, std::memory_order_acq_rel);
+                if (other) other->neighbors[side ^ 1].store(nullptr, std::memory_order_release);
+            }
+        }
+
+    public:
+        ChunkMap() = default;
+
+        ~ChunkMap() {
+            for (auto& shard : shards) {
+                Table* table = shard.table.load(std::memory_order_acquire);
+                if (not table) continue;
+                for (size i = 0; i < table->capacity; ++i) {
+                    Node* node = table->slots[i].load(std::memory_order_relaxed);
+                    if (not node or node == TOMBSTONE) continue;
+                    unlink(&node->chunk.value());
+                    delete node;
+                }
+                delete table;
+            }
+        }
+
+        ChunkMap(const ChunkMap&) = delete;
+        ChunkMap& operator=(const ChunkMap&) = delete;
+
+        IPtr<Chunk> find(const Pos<int32>& pos) const {
+            Reclaimer::Guard guard;
+            return peek(pos);
+        }
+
+        // find() without taking a reference. Caller holds a Reclaimer::Guard for as long as it uses the view:
+        // an erased chunk's node, and with it the node's reference, is only freed once every guard has ended.
+        View<Chunk> peek(const Pos<int32>& pos) const {
+            const uint64 h = hash(pos);
+            Node* node = probe(shard_for(h).table.load(std::memory_order_acquire), h, pos);
+            return node ? node->chunk.view() : nullptr;
+        }
+
+        bool contains(const Pos<int32>& pos) const {
+            const uint64 h = hash(pos);
+            Reclaimer::Guard guard;
+            return probe(shard_for(h).table.load(std::memory_order_acquire), h, pos) != nullptr;
+        }
+
+        // Returns the chunk already at pos, or inserts the one create() returns. create() runs before any lock is
+        // taken; its chunk is dropped again when another thread inserted pos first.
+        template <typename F>
+        IPtr<Chunk> find_or_insert(const Pos<int32>& pos, F&& create) {
+            if (auto chunk = find(pos)) return chunk;
+
+            IPtr<Chunk> created = create();
+            const uint64 h = hash(pos);
+            Shard& shard = shard_for(h);
+            AreaLock lock(*this, pos);
+
+            if (Node* node = probe(shard.table.load(std::memory_order_relaxed), h, pos)) return node->chunk;
+
+            reserve_one(shard);
+            Table* table = shard.table.load(std::memory_order_relaxed);
+
+            // Reuse the first tombstone on the probe path
+            const size mask = table->capacity - 1;
+            size slot = h & mask;
+            while (true) {
+                Node* current = table->slots[slot].load(std::memory_order_relaxed);
+                if (not current or current == TOMBSTONE) {
+                    if (not current) ++shard.used;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+
+            Node* node = new Node{ pos, std::move(created) };
+            table->slots[slot].store(node, std::memory_order_release);
+            ++shard.live;
+            total.fetch_add(1, std::memory_order_relaxed);
+
+            link(pos, &node->chunk.value());
+            return node->chunk;
+        }
+
+        // Returns the removed chunk, or nullptr when pos was not present.
+        IPtr<Chunk> erase(const Pos<int32>& pos) {
+            const uint64 h = hash(pos);
+            Shard& shard = shard_for(h);
+            AreaLock lock(*this, pos);
+
+            Table* table = shard.table.load(std::memory_order_relaxed);
+            if (not table) return nullptr;
+
+            const size mask = table->capacity - 1;
+            for (size i = 0, slot = h & mask; i < table->capacity; ++i, slot = (slot + 1) & mask) {
+                Node* node = table->slots[slot].load(std::memory_order_relaxed);
+                if (not node) return nullptr;
+                if (node == TOMBSTONE or not same(node->pos, pos)) continue;
+
+                table->slots[slot].store(TOMBSTONE, std::memory_order_release);
+                --shard.live;
+                total.fetch_sub(1, std::memory_order_relaxed);
+
+                // Unlinked before the retire, so a guard that starts after it cannot reach the chunk through a link
+                IPtr<Chunk> chunk = node->chunk;
+                unlink(&chunk.value());
+                Reclaimer::retire(node);
+                return chunk;
+            }
+            return nullptr;
+        }
+
+        // Holds every shard at once, in array order, since links cross shards
+        none clear() {
+            for (auto& shard : shards) shard.write_mutex.lock();
+            for (auto& shard : shards) {
+                Table* table = shard.table.exchange(nullptr, std::memory_order_acq_rel);
+                if (not table) continue;
+
+                for (size i = 0; i < table->capacity; ++i) {
+                    Node* node = table->slots[i].load(std::memory_order_relaxed);
+                    if (not node or node == TOMBSTONE) continue;
+                    unlink(&node->chunk.value());
+                    Reclaimer::retire(node);
+                }
+                total.fetch_sub(shard.live, std::memory_order_relaxed);
+                shard.live = 0;
+                shard.used = 0;
+                Reclaimer::retire(table);
+            }
+            for (auto& shard : shards) shard.write_mutex.unlock();
+        }
+
+        size count() const {
+            return total.load(std::memory_order_relaxed);
+        }
+
+        // Visits every chunk present when each shard is reached. Runs without locks, so f may see a chunk that is
+        // being removed concurrently; the node's reference stays valid for the duration of the call, and f copies
+        // it to keep the chunk past that.
+        template <typename F>
+        none for_each(F&& f) const {
+            for (const auto& shard : shards) {
+                Reclaimer::Guard guard;
+                const Table* table = shard.table.load(std::memory_order_acquire);
+                if (not table) continue;
+
+                for (size i = 0; i < table->capacity; ++i) {
+                    Node* node = table->slots[i].load(std::memory_order_acquire);
+                    if (not node or node == TOMBSTONE) continue;
+
+                    f(node->pos, node->chunk);
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,44 @@
+module;
+
+#include <godot_cpp/classes/mesh_instance3d.hpp>
+
+#include <includes.hpp>
+
+export module game.world.chunk_nodes;
+
+import misc.dict;
+import misc.number;
+import misc.pos;
+
+using namespace godot;
+
+export namespace craftbuild {
+    // The engine side of the loaded chunks: the node each meshed chunk is drawn and collided through.
+    // Kept out of Chunk so the chunk module builds without the engine. Main thread only.
+    class ChunkNodes {
+        Dict<Pos<int32>, MeshInstance3D*> nodes;
+
+    public:
+        MeshInstance3D* find(const Pos<int32>& chunk_pos) const {
+            auto it = nodes.find(chunk_pos);
+            return it == nodes.end() ? nullptr : it->second;
+        }
+
+        none insert(const Pos<int32>& chunk_pos, MeshInstance3D* node) {
+            nodes[chunk_pos] = node;
+        }
+
+        // Frees the chunk's node, if it has one
+        none remove(const Pos<int32>& chunk_pos) {
+            auto it = nodes.find(chunk_pos);
+            if (it == nodes.end()) return;
+            it->second->queue_free();
+            nodes.erase(it);
+        }
+
+        none clear() {
+            for (auto& [chunk_pos, node] : nodes) node->queue_free();
+            nodes.clear();
+        }
+    };
+}
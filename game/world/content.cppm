@@ -0,0 +1,67 @@
+module;
+
+#include <includes.hpp>
+
+export module game.world.content;
+
+import misc.number;
+import game.block;
+import game.block.normal_blocks;
+import game.world.biome;
+import game.world.feature;
+import game.world.terrain;
+
+export namespace craftbuild {
+    // Registers every tag, block, biome and feature of the overworld. Block ids follow registration
+    // order, so the game and the tools must both go through here to agree on saves.
+    // Textures are only named; the game loads them when it builds the atlas.
+    inline none register_world_content() {
+        TagRegistry::register_tag("face");
+        TagRegistry::register_tag("transparent");
+
+        BlockRegistry::register_block<Air>          ("Air",           "");
+        BlockRegistry::register_block<Grass>        ("Grass Block",   "grass_block.png");
+        BlockRegistry::register_block<Dirt>         ("Dirt",          "dirt.png");
+        BlockRegistry::register_block<Stone>        ("Stone",         "stone.png");
+        BlockRegistry::register_block<OakPlanks>    ("Oak Planks",    "oak_planks.png");
+        BlockRegistry::register_block<DiamondBlock> ("Diamond Block", "diamond_block.png");
+        BlockRegistry::register_block<DiamondOre>   ("Diamond Ore",   "diamond_ore.png");
+        BlockRegistry::register_block<Bedrock>      ("Bedrock",       "bedrock.png");
+
+        Biome plains;
+        plains.base_height = 5.0f;
+        plains.base_noise = 0.1f;
+        plains.detail_height = 4.0f;
+        plains.detail_noise = 0.2f;
+        plains.min_height = 40;
+
+        Biome normal;
+        normal.base_height = 60.0f;
+        normal.base_noise = 0.05f;
+        normal.detail_height = 8.0f;
+        normal.detail_noise = 0.5f;
+        normal.min_height = 40;
+
+        Biome mountains;
+        mountains.base_height = 140.0f;
+        mountains.base_noise = 0.02f;
+        mountains.detail_height = 35.0f;
+        mountains.detail_noise = 0.15f;
+        mountains.min_height = 40;
+
+        BiomeRegistry::register_biome("Plains", plains);
+        BiomeRegistry::register_biome("Normal", normal);
+        BiomeRegistry::register_biome("Mountains", mountains);
+
+        FeatureRegistry::register_ore({
+            BlockRegistry::get_id("Diamond Ore"),
+            BlockRegistry::get_id("Stone"),
+            8, 2,
+            TrapezoidHeight::of(VerticalAnchor::absolute(18), VerticalAnchor::absolute(38), 8)
+        });
+        FeatureRegistry::register_boulder({ BlockRegistry::get_id("Stone"), BlockRegistry::get_id("Grass Block"), 1, 3, 12 });
+    }
+
+    // Frequency the overworld noise has always been sampled at.
+    inline constexpr float32 WORLD_NOISE_FREQUENCY = 0.0125f;
+}
@@ -0,0 +1,147 @@
+module;
+
+#include <includes.hpp>
+
+#include <vector>
+
+export module game.world.feature;
+
+import misc.ptr;
+import misc.range;
+import misc.number;
+import game.world.terrain;
+
+export namespace craftbuild {
+    // Structure writes may arrive in any order, so they have to commute: REPLACE writes that
+    // overlap should agree on the block, IF_AIR writes never override anything solid. REPLACE only
+    // holds inside the placing chunk; what spills into a neighbour is written IF_AIR.
+    enum class WriteMode : uint8 {
+        REPLACE,
+        IF_AIR,
+    };
+
+    struct OreConfiguration {
+        uint32 ore_block = 0;
+        uint32 target_block = 0;
+        int32 vein_size = 4;
+        int32 count = 1;
+        HeightProviderPtr height;
+    };
+
+    // Region is the chunk-local write target of a feature (see Chunk::ProtoChunk).
+    // It must expose SIZE_X/SIZE_Y/SIZE_Z, contains(), get_block() and set_block().
+    template <typename Region>
+    concept FeatureRegion = requires(Region region, const Region& const_region, int32 v, uint32 id) {
+        { const_region.contains(v, v, v) } -> std::convertible_to<bool>;
+        { const_region.get_block(v, v, v) } -> std::convertible_to<uint32>;
+        region.set_block(v, v, v, id);
+    };
+
+    // Structures may spill over the chunk border; place_block() forwards those blocks to the
+    // neighbouring chunk instead of dropping them.
+    template <typename Region>
+    concept StructureRegion = FeatureRegion<Region> and requires(Region region, const Region& const_region, int32 v, uint32 id, WriteMode mode) {
+        { const_region.surface_y(v, v) } -> std::convertible_to<int32>;
+        region.place_block(v, v, v, id, mode);
+    };
+
+    struct BoulderConfiguration {
+        uint32 block = 0;
+        uint32 surface_block = 0;
+        int32 min_radius = 1;
+        int32 max_radius = 2;
+        int32 rarity = 8;
+    };
+
+    struct OreFeature {
+        // Random walk veins starting inside the chunk; blocks that would leave the chunk are dropped,
+        // so the result only depends on the chunk's own seed and terrain.
+        template <FeatureRegion Region>
+        static none place(const OreConfiguration& config, Region& region, RandomSource& random, const WorldGenerationContext& context) {
+            if (not config.height or config.vein_size <= 0) return;
+
+            for (auto i : range<int32>(config.count)) {
+                int32 x = random.next_int(Region::SIZE_X);
+                int32 z = random.next_int(Region::SIZE_Z);
+                int32 y = config.height.value().sample(random, context);
+
+                for (auto n : range<int32>(config.vein_size)) {
+                    if (region.contains(x, y, z) and region.get_block(x, y, z) == config.target_block) {
+                        region.set_block(x, y, z, config.ore_block);
+                    }
+
+                    switch (random.next_int(6)) {
+                    case 0: ++x; break;
+                    case 1: --x; break;
+                    case 2: ++y; break;
+                    case 3: --y; break;
+                    case 4: ++z; break;
+                    case 5: --z; break;
+                    }
+                }
+            }
+        }
+    };
+
+    struct BoulderFeature {
+        template <StructureRegion Region>
+        static none place(const BoulderConfiguration& config, Region& region, RandomSource& random) {
+            if (config.rarity <= 0 or random.next_int(config.rarity) != 0) return;
+
+            const int32 x = random.next_int(Region::SIZE_X);
+            const int32 z = random.next_int(Region::SIZE_Z);
+            const int32 y = region.surface_y(x, z);
+            if (y < 0 or region.get_block(x, y, z) != config.surface_block) return;
+
+            const int32 radius = random.next_int(config.min_radius, config.max_radius);
+            for (auto dx : range<int32>(-radius, radius + 1)) {
+                for (auto dy : range<int32>(-radius, radius + 1)) {
+                    for (auto dz : range<int32>(-radius, radius + 1)) {
+                        const int32 distance = dx * dx + dy * dy + dz * dz;
+                        const int32 limit = radius * radius;
+
+                        // Rough the shell up a little; the draw happens for every cell so the stream stays in sync.
+                        const bool keep_edge = random.next_int(2) == 0;
+                        if (distance > limit or (distance > limit - radius and not keep_edge)) continue;
+
+                        region.place_block(x + dx, y + dy, z + dz, config.block, WriteMode::REPLACE);
+                    }
+                }
+            }
+        }
+    };
+
+    struct FeatureRegistry {
+        inline static constexpr uint64 STRUCTURE_SALT = 0x737472756374ull;
+
+        inline static std::vector<OreConfiguration> ores;
+        inline static std::vector<BoulderConfiguration> boulders;
+
+        static none register_ore(const OreConfiguration& config) {
+            ores.push_back(config);
+        }
+
+        static none register_boulder(const BoulderConfiguration& config) {
+            boulders.push_back(config);
+        }
+
+        template <FeatureRegion Region>
+        static none place_ores(Region& region, uint32 chunk_seed, const WorldGenerationContext& context) {
+            // Each feature gets its own stream so adding a feature does not reshuffle the others.
+            const RandomSource chunk_random(chunk_seed);
+            for (auto i : range<size>(ores.size())) {
+                RandomSource random = chunk_random.fork(i);
+                OreFeature::place(ores[i], region, random, context);
+            }
+        }
+
+        template <StructureRegion Region>
+        static none place_structures(Region& region, uint32 chunk_seed) {
+            const RandomSource chunk_random = RandomSource(chunk_seed).fork(STRUCTURE_SALT);
+            for (auto i : range<size>(boulders.size())) {
+                RandomSource random = chunk_random.fork(i);
+                BoulderFeature::place(boulders[i], region, random);
+            }
+        }
+    };
+}
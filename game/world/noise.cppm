@@ -0,0 +1,65 @@
+module;
+
+#include <includes.hpp>
+
+#include <algorithm>
+
+#include <thirdparty/FastNoiseLite.h>
+
+export module game.world.noise;
+
+import misc.number;
+
+export namespace craftbuild {
+    // The world's FastNoiseLite, set up the way Godot's FastNoiseLite resource was with TYPE_SIMPLEX:
+    // OpenSimplex2 with 5 octaves of FBm, so a seed gives the same terrain as before. It is plain C++,
+    // so the game and the tools generate alike, and every query is const so workers can share one instance.
+    class Noise {
+    public:
+        inline static constexpr int32 MAX_OCTAVES = 8;
+
+    private:
+        fastnoiselite::FastNoiseLite noise;
+
+        int32 seed = 0;
+        float32 frequency = 0.01f;
+
+    public:
+        Noise() : Noise(0) {}
+        explicit Noise(int32 seed, float32 frequency = 0.01f) {
+            set_seed(seed);
+            set_frequency(frequency);
+            set_fractal(5);
+        }
+
+        none set_seed(int32 new_seed) {
+            seed = new_seed;
+            noise.SetSeed(seed);
+        }
+        int32 get_seed() const {
+            return seed;
+        }
+
+        none set_frequency(float32 new_frequency) {
+            frequency = new_frequency;
+            noise.SetFrequency(frequency);
+        }
+        float32 get_frequency() const {
+            return frequency;
+        }
+
+        none set_fractal(int32 new_octaves, float32 new_lacunarity = 2.0f, float32 new_gain = 0.5f) {
+            noise.SetFractalOctaves(std::clamp(new_octaves, 1, MAX_OCTAVES));
+            noise.SetFractalLacunarity(new_lacunarity);
+            noise.SetFractalGain(new_gain);
+        }
+
+        float32 get_noise_2d(float32 x, float32 y) const {
+            return noise.GetNoise(x, y);
+        }
+
+        float32 get_noise_3d(float32 x, float32 y, float32 z) const {
+            return noise.GetNoise(x, y, z);
+        }
+    };
+}
@@ -0,0 +1,138 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+export module game.world.pending_writes;
+
+import misc.pos;
+import misc.dict;
+import misc.range;
+import misc.number;
+import game.world.feature;
+
+export namespace craftbuild {
+    // A block a structure wants to place in another chunk, in that chunk's local coordinates.
+    struct PendingBlock {
+        uint8 x, y, z;
+        WriteMode mode;
+        uint32 block_id;
+    };
+
+    struct PendingBatch {
+        Pos<int32> chunk;
+        std::vector<PendingBlock> blocks;
+    };
+
+    inline bool should_write(uint32 existing, WriteMode mode, uint32 air) {
+        return mode == WriteMode::REPLACE or existing == air;
+    }
+
+    // Out-of-chunk structure writes waiting for their target chunk. Writes for a chunk that is not
+    // generated yet are parked here and drained by that chunk's own terrain job; writes for a
+    // generated chunk are merged into it right away, under the queue lock.
+    class PendingWrites {
+        Dict<Pos<int32>, std::vector<PendingBlock>> queue;
+        mutable std::mutex mutex;
+
+    public:
+        // Runs commit(incoming) under the queue lock, so a writer can never observe the chunk as
+        // not generated after its queue has already been drained.
+        template <typename Commit>
+        none drain(const Pos<int32>& chunk, Commit&& commit) {
+            std::lock_guard lock(mutex);
+
+            std::vector<PendingBlock> incoming;
+            auto it = queue.find(chunk);
+            if (it != queue.end()) {
+                incoming = std::move(it->second);
+                queue.erase(it);
+            }
+
+            commit(incoming);
+        }
+
+        // Hands every batch to merge(batch) under the queue lock. merge returns false when the target is not
+        // loaded or not generated yet, and the batch is queued for the target's terrain job instead. Chunks are
+        // taken out of the world under the same lock (see exclusive()), so a batch is never merged into one that
+        // is already gone.
+        template <typename Merge>
+        none submit(std::vector<PendingBatch>&& batches, Merge&& merge) {
+            std::lock_guard lock(mutex);
+
+            for (auto& batch : batches) {
+                if (batch.blocks.empty() or merge(batch)) continue;
+
+                auto& target = queue[batch.chunk];
+                target.insert(target.end(), batch.blocks.begin(), batch.blocks.end());
+            }
+        }
+
+        // Runs fn under the queue lock, so no batch is merged or queued meanwhile
+        template <typename F>
+        auto exclusive(F&& fn) {
+            std::lock_guard lock(mutex);
+            return fn();
+        }
+
+        size count() const {
+            std::lock_guard lock(mutex);
+            return queue.size();
+        }
+
+        // Blocks queued over all chunks; count() is the number of chunks waiting
+        size block_count() const {
+            std::lock_guard lock(mutex);
+            size blocks = 0;
+            for (const auto& [chunk, writes] : queue) blocks += writes.size();
+            return blocks;
+        }
+
+        none clear() {
+            std::lock_guard lock(mutex);
+            queue.clear();
+        }
+
+        none save(std::ostream& os) const {
+            std::lock_guard lock(mutex);
+
+            uint32 chunk_count = static_cast<uint32>(queue.size());
+            os.write(reinterpret_cast<const byte*>(&chunk_count), sizeof(uint32));
+
+            for (const auto& [pos, blocks] : queue) {
+                os.write(reinterpret_cast<const byte*>(&pos.x), sizeof(int32));
+                os.write(reinterpret_cast<const byte*>(&pos.z), sizeof(int32));
+
+                uint32 block_count = static_cast<uint32>(blocks.size());
+                os.write(reinterpret_cast<const byte*>(&block_count), sizeof(uint32));
+                os.write(reinterpret_cast<const byte*>(blocks.data()), block_count * sizeof(PendingBlock));
+            }
+        }
+
+        none load(std::istream& is) {
+            std::lock_guard lock(mutex);
+            queue.clear();
+
+            uint32 chunk_count = 0;
+            is.read(reinterpret_cast<byte*>(&chunk_count), sizeof(uint32));
+
+            for (auto i : range<uint32>(chunk_count)) {
+                Pos<int32> pos{ 0, 0, 0 };
+                is.read(reinterpret_cast<byte*>(&pos.x), sizeof(int32));
+                is.read(reinterpret_cast<byte*>(&pos.z), sizeof(int32));
+
+                uint32 block_count = 0;
+                is.read(reinterpret_cast<byte*>(&block_count), sizeof(uint32));
+                if (not is) return;
+
+                auto& blocks = queue[pos];
+                blocks.resize(block_count);
+                is.read(reinterpret_cast<byte*>(blocks.data()), block_count * sizeof(PendingBlock));
+            }
+        }
+    };
+}
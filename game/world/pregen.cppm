@@ -0,0 +1,277 @@
+module;
+
+#include <includes.hpp>
+
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <condition_variable>
+
+export module game.world.pregen;
+
+import misc.ptr;
+import misc.pos;
+import misc.range;
+import misc.number;
+import game.thread;
+import game.world.save;
+import game.world.region;
+import game.world.noise;
+import game.world.chunk;
+import game.world.chunk_map;
+import game.world.content;
+import game.world.pending_writes;
+
+export namespace craftbuild {
+    enum class PregenShape : uint8 {
+        SQUARE,
+        CIRCLE,
+    };
+
+    struct PregenOptions {
+        std::filesystem::path save_path;
+        int32 seed = 0;         // Only used when the save does not exist yet
+        int32 center_x = 0;     // In chunks
+        int32 center_z = 0;
+        int32 radius = 16;      // In chunks
+        PregenShape shape = PregenShape::SQUARE;
+        size threads = 0;       // 0 uses every hardware thread
+    };
+
+    struct PregenProgress {
+        size done = 0;
+        size total = 0;
+        float64 seconds = 0.0;
+
+        float64 chunks_per_second() const {
+            return seconds > 0.0 ? static_cast<float64>(done) / seconds : 0.0;
+        }
+    };
+
+    // Generates an area of the overworld without the engine and writes it to a save the game can open.
+    // Chunks already in the save are kept as they are, and so are its sections (player, queued structure writes).
+    // New chunks are held in memory until save() writes them to the region files next to the save.
+    class Pregenerator {
+        PregenOptions options;
+
+        ChunkMap chunks;
+        RegionStore regions;
+
+        PendingWrites pending_writes;
+        Noise noise;
+        int32 seed = 0;
+        std::vector<std::pair<SaveSection, std::string>> carried_sections;
+
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        std::atomic<size> done = 0;
+
+        GenerationTimings timings;
+        std::mutex timings_mutex;
+
+        none generate(IPtr<Chunk> chunk) {
+            GenerationTimings local;
+            auto outgoing = chunk.value().generate_terrain(seed, noise, pending_writes, &local);
+
+            const auto merge_start = std::chrono::steady_clock::now();
+            pending_writes.submit(std::move(outgoing), [this](const PendingBatch& batch) {
+                Reclaimer::Guard guard;
+                View<Chunk> target = chunks.peek(batch.chunk);
+                if (not target or not target.value().is_generated()) return false;
+                target.value().apply_pending(batch.blocks);
+                return true;
+            });
+            local.merge += std::chrono::duration<float64>(std::chrono::steady_clock::now() - merge_start).count();
+
+            std::lock_guard lock(timings_mutex);
+            timings += local;
+        }
+
+    public:
+        explicit Pregenerator(const PregenOptions& options) : options(options), seed(options.seed) {}
+
+        int32 get_seed() const {
+            return seed;
+        }
+
+        size chunk_count() const {
+            return chunks.count();
+        }
+
+        IPtr<Chunk> find_chunk(const Pos<int32>& pos) const {
+            return chunks.find(pos);
+        }
+
+        // Drops an unmodified chunk the way the game unloads one, so the next run() generates it again. Modified
+        // chunks would be stored instead and are kept; returns whether the chunk was dropped.
+        bool unload(const Pos<int32>& pos) {
+            IPtr<Chunk> chunk = chunks.find(pos);
+            if (not chunk or chunk.value().is_modified()) return false;
+            return static_cast<bool>(chunks.erase(pos));
+        }
+
+        // Structure blocks waiting for chunks that are not generated
+        size pending_block_count() const {
+            return pending_writes.block_count();
+        }
+
+        // Summed over all workers, so it can exceed the wall time of run().
+        GenerationTimings get_timings() {
+            std::lock_guard lock(timings_mutex);
+            return timings;
+        }
+
+        std::vector<Pos<int32>> collect_targets() {
+            std::vector<Pos<int32>> targets;
+            const int32 r = std::max(options.radius, 0);
+
+            // Ring order keeps neighbouring chunks in flight together, so structure writes merge early.
+            for (auto ring : range<int32>(r + 1)) {
+                for (auto x : range<int32>(-ring, ring + 1)) {
+                    for (auto z : range<int32>(-ring, ring + 1)) {
+                        if (std::abs(x) != ring and std::abs(z) != ring) continue;
+                        if (options.shape == PregenShape::CIRCLE and x * x + z * z > r * r) continue;
+
+                        const Pos<int32> pos(options.center_x + x, 0, options.center_z + z);
+                        if (auto chunk = find_chunk(pos); chunk and chunk.value().is_generated()) continue;
+                        if (regions.contains(pos)) continue;
+                        targets.push_back(pos);
+                    }
+                }
+            }
+            return targets;
+        }
+
+        // Reads the existing save, if any. Returns false only when a save exists but cannot be read.
+        bool load() {
+            if (not options.save_path.empty()) regions.open(options.save_path.parent_path() / "region");
+
+            std::ifstream ifs(options.save_path, std::ios::binary);
+            if (ifs.is_open()) {
+                SaveHeader header;
+                if (not SaveFile::read_header(ifs, header)) return false;
+
+                // A format 1 save cannot be split into player and pending writes without the engine
+                if (header.format < 2) return false;
+
+                seed = static_cast<int32>(header.seed);
+
+                // Inline chunks of a format 2 save; save() moves them to region files
+                for (auto i : range<uint32>(header.chunk_count)) {
+                    const Pos<int32> pos = SaveFile::read_chunk_pos(ifs);
+
+                    auto chunk = chunks.find_or_insert(pos, [&]() {
+                        IPtr<Chunk> created = ChunkPool::acquire();
+                        created.value().chunk_pos = Pos<int32>(pos.x, 0, pos.z);
+                        return created;
+                    });
+                    if (not SaveFile::read_chunk(ifs, chunk.value())) return false;
+                    chunk.value().mark_loaded();
+                }
+
+                for (auto& [id, payload] : SaveFile::read_sections(ifs)) {
+                    if (id == SaveSection::PENDING_WRITES) {
+                        std::istringstream section(payload);
+                        pending_writes.load(section);
+                    }
+                    else carried_sections.emplace_back(id, std::move(payload));
+                }
+            }
+
+            noise.set_frequency(WORLD_NOISE_FREQUENCY);
+            noise.set_seed(seed);
+            return true;
+        }
+
+        // Generates every missing chunk of the area on all workers. progress is called about once a second
+        // from the calling thread.
+        PregenProgress run(const std::function<none(const PregenProgress&)>& progress = nullptr) {
+            return run(collect_targets(), progress);
+        }
+
+        // Generates the given chunks; positions that are already present, in memory or in the save, are skipped.
+        PregenProgress run(const std::vector<Pos<int32>>& targets, const std::function<none(const PregenProgress&)>& progress = nullptr) {
+            const auto start = std::chrono::steady_clock::now();
+            auto elapsed = [&start]() {
+                return std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+            };
+
+            std::vector<IPtr<Chunk>> pending;
+            pending.reserve(targets.size());
+            for (const auto& pos : targets) {
+                if (chunks.contains(pos) or regions.contains(pos)) continue;
+
+                pending.push_back(chunks.find_or_insert(pos, [&]() {
+                    IPtr<Chunk> chunk = ChunkPool::acquire();
+                    chunk.value().chunk_pos = Pos<int32>(pos.x, 0, pos.z);
+                    return chunk;
+                }));
+            }
+
+            done.store(0, std::memory_order_relaxed);
+            {
+                const size threads = options.threads != 0 ? options.threads : std::max<size>(std::thread::hardware_concurrency(), 1);
+                JobSystem pool(threads, 0);
+
+                for (const auto& chunk : pending) {
+                    pool.submit(JobPriority::FAR, [this, chunk, total = pending.size()]() {
+                        generate(chunk);
+                        if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == total) {
+                            std::lock_guard lock(done_mutex);
+                            done_cv.notify_all();
+                        }
+                    });
+                }
+
+                std::unique_lock lock(done_mutex);
+                while (not done_cv.wait_for(lock, std::chrono::seconds(1), [&]() { return done.load(std::memory_order_acquire) == pending.size(); })) {
+                    if (progress) progress({ done.load(std::memory_order_acquire), pending.size(), elapsed() });
+                }
+            }
+
+            return { pending.size(), pending.size(), elapsed() };
+        }
+
+        // Writes to a temporary file first so an interrupted run never leaves a truncated save behind.
+        bool save() {
+            std::filesystem::create_directories(options.save_path.parent_path());
+            std::filesystem::path temp_path = options.save_path;
+            temp_path += ".tmp";
+
+            {
+                std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+                if (not ofs.is_open()) return false;
+
+                // Every chunk is stored, modified or not: skipping generation later is the point of pregenerating
+                bool written = true;
+                chunks.for_each([&](const Pos<int32>& pos, const IPtr<Chunk>& chunk) {
+                    written = regions.write(pos, chunk.value()) and written;
+                });
+                if (not written) return false;
+
+                SaveFile::write_header(ofs, static_cast<uint32>(seed), 0);
+
+                for (const auto& [id, payload] : carried_sections) SaveFile::write_section(ofs, id, payload);
+
+                std::ostringstream pending_data;
+                pending_writes.save(pending_data);
+                SaveFile::write_section(ofs, SaveSection::PENDING_WRITES, pending_data.str());
+
+                if (not ofs.flush()) return false;
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temp_path, options.save_path, error);
+            return not error;
+        }
+    };
+}
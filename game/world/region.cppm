@@ -0,0 +1,346 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+
+export module game.world.region;
+
+import misc.pos;
+import misc.dict;
+import misc.range;
+import misc.number;
+import game.world.save;
+import game.world.chunk;
+import game.world.pending_writes;
+
+export namespace craftbuild {
+    // One r.<x>.<z>.cbregion file holds a 32x32 square of chunks and is split into 4 KiB sectors:
+    //   sector 0 : location table, one uint32 per chunk (x + z * 32), first sector << 8 | sector count; 0 is absent
+    //   sectors  : per chunk a uint32 byte length, then the chunk as SaveFile::write_chunk() writes it
+    // A rewrite goes to free sectors and only then is the table entry switched over, so a crash in between leaves
+    // the old copy in place. Freed sectors are reused first fit; the file only grows when no run is large enough.
+    class RegionFile {
+    public:
+        inline static constexpr int32 SIZE = 32;
+        inline static constexpr size CHUNK_COUNT = SIZE * SIZE;
+        inline static constexpr size SECTOR_SIZE = 4096;
+        inline static constexpr uint32 MAX_SECTORS_PER_CHUNK = 255;
+
+    private:
+        std::filesystem::path file_path;
+        std::fstream file;
+        uint32 locations[CHUNK_COUNT] = {};
+        std::vector<bool> used;     // Per sector; the table's own sector is always used
+        mutable std::mutex mutex;
+
+        static uint32 first_sector(uint32 location) { return location >> 8; }
+        static uint32 sector_count(uint32 location) { return location & 0xFF; }
+
+        none mark(uint32 first, uint32 count, bool in_use) {
+            if (used.size() < first + count) used.resize(first + count, false);
+            for (auto i : range<uint32>(first, first + count)) used[i] = in_use;
+        }
+
+        uint32 allocate(uint32 count) {
+            uint32 run = 0;
+            for (auto i : range<uint32>(1, static_cast<uint32>(used.size()))) {
+                run = used[i] ? 0 : run + 1;
+                if (run == count) return i + 1 - count;
+            }
+            // Extend the free run at the end of the file, if any
+            return static_cast<uint32>(used.size()) - run;
+        }
+
+        bool write_location(size index, uint32 location) {
+            file.seekp(static_cast<std::streamoff>(index * sizeof(uint32)));
+            file.write(reinterpret_cast<const byte*>(&location), sizeof(uint32));
+            file.flush();
+            if (not file) return false;
+
+            locations[index] = location;
+            return true;
+        }
+
+    public:
+        // Opens the file, creating it with an empty table when missing
+        bool open(const std::filesystem::path& path) {
+            std::lock_guard lock(mutex);
+            if (not std::filesystem::exists(path)) {
+                std::ofstream create(path, std::ios::binary);
+                const std::string empty(SECTOR_SIZE, '\0');
+                create.write(empty.data(), static_cast<std::streamsize>(empty.size()));
+                if (not create.flush()) return false;
+            }
+
+            file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+            if (not file.is_open()) return false;
+            file_path = path;
+
+            file.read(reinterpret_cast<byte*>(locations), sizeof(locations));
+            if (not file) return false;
+
+            used.assign(1, true);
+            for (const uint32 location : locations) {
+                if (location != 0) mark(first_sector(location), sector_count(location), true);
+            }
+            return true;
+        }
+
+        bool contains(size index) const {
+            std::lock_guard lock(mutex);
+            return locations[index] != 0;
+        }
+
+        bool read(size index, std::string& payload) {
+            std::lock_guard lock(mutex);
+            const uint32 location = locations[index];
+            if (location == 0) return false;
+
+            uint32 length = 0;
+            file.seekg(static_cast<std::streamoff>(first_sector(location) * SECTOR_SIZE));
+            file.read(reinterpret_cast<byte*>(&length), sizeof(uint32));
+            if (not file or length + sizeof(uint32) > sector_count(location) * SECTOR_SIZE) {
+                file.clear();
+                return false;
+            }
+
+            payload.resize(length);
+            file.read(payload.data(), length);
+            if (not file) {
+                file.clear();
+                return false;
+            }
+            return true;
+        }
+
+        bool write(size index, const std::string& payload) {
+            const uint32 length = static_cast<uint32>(payload.size());
+            const uint32 count = static_cast<uint32>((length + sizeof(uint32) + SECTOR_SIZE - 1) / SECTOR_SIZE);
+            if (count > MAX_SECTORS_PER_CHUNK) return false;
+
+            std::lock_guard lock(mutex);
+            const uint32 first = allocate(count);
+
+            // Padded to whole sectors, so the file never ends inside one
+            std::string sectors(count * SECTOR_SIZE, '\0');
+            std::memcpy(sectors.data(), &length, sizeof(uint32));
+            std::memcpy(sectors.data() + sizeof(uint32), payload.data(), length);
+
+            file.seekp(static_cast<std::streamoff>(first * SECTOR_SIZE));
+            file.write(sectors.data(), static_cast<std::streamsize>(sectors.size()));
+            file.flush();
+            if (not file) {
+                file.clear();
+                return false;
+            }
+
+            const uint32 old = locations[index];
+            if (not write_location(index, first << 8 | count)) {
+                file.clear();
+                return false;
+            }
+
+            if (old != 0) mark(first_sector(old), sector_count(old), false);
+            mark(first, count, true);
+            return true;
+        }
+
+        bool erase(size index) {
+            std::lock_guard lock(mutex);
+            const uint32 old = locations[index];
+            if (old == 0) return true;
+            if (not write_location(index, 0)) {
+                file.clear();
+                return false;
+            }
+            mark(first_sector(old), sector_count(old), false);
+            return true;
+        }
+
+        std::vector<size> indices() const {
+            std::lock_guard lock(mutex);
+            std::vector<size> result;
+            for (auto i : range<size>(CHUNK_COUNT)) {
+                if (locations[i] != 0) result.push_back(i);
+            }
+            return result;
+        }
+
+        uint64 bytes() const {
+            std::lock_guard lock(mutex);
+            return used.size() * SECTOR_SIZE;
+        }
+
+        // Makes every write so far durable
+        bool sync() {
+            std::lock_guard lock(mutex);
+            file.flush();
+            return static_cast<bool>(file) and SaveFile::sync(file_path);
+        }
+    };
+
+    // The chunks of a world, in region files under one directory. Files are opened on first use and kept open;
+    // the directory is only created by the first write, so looking up a world without one has no side effects.
+    class RegionStore {
+        std::filesystem::path directory;
+        Dict<Pos<int32>, std::unique_ptr<RegionFile>> regions;  // nullptr: no such file yet
+        mutable std::mutex mutex;
+
+        // Floor division, so chunk -1 is in region -1
+        static Pos<int32> region_of(const Pos<int32>& pos) {
+            return Pos<int32>(pos.x >> 5, 0, pos.z >> 5);
+        }
+
+        static size index_of(const Pos<int32>& pos) {
+            return static_cast<size>(pos.x & (RegionFile::SIZE - 1)) + static_cast<size>(pos.z & (RegionFile::SIZE - 1)) * RegionFile::SIZE;
+        }
+
+        std::filesystem::path path_of(const Pos<int32>& region) const {
+            return directory / ("r." + std::to_string(region.x) + "." + std::to_string(region.z) + ".cbregion");
+        }
+
+        RegionFile* region_for(const Pos<int32>& pos, bool create) {
+            if (directory.empty()) return nullptr;
+
+            const Pos<int32> region = region_of(pos);
+            std::lock_guard lock(mutex);
+            auto it = regions.find(region);
+            if (it != regions.end() and (it->second or not create)) return it->second.get();
+
+            const auto path = path_of(region);
+            std::error_code error;
+            if (not create and not std::filesystem::exists(path, error)) {
+                regions.try_emplace(region, nullptr);
+                return nullptr;
+            }
+            if (create) std::filesystem::create_directories(directory, error);
+
+            auto file = std::make_unique<RegionFile>();
+            if (not file->open(path)) return nullptr;
+            RegionFile* result = file.get();
+            regions[region] = std::move(file);
+            return result;
+        }
+
+    public:
+        // Closes every file and switches to dir. Not while other calls may be running.
+        none open(const std::filesystem::path& dir) {
+            std::lock_guard lock(mutex);
+            regions.clear();
+            directory = dir;
+        }
+
+        bool contains(const Pos<int32>& pos) {
+            RegionFile* region = region_for(pos, false);
+            return region and region->contains(index_of(pos));
+        }
+
+        // Reads the chunk body only; flags and pending writes are left to the caller. The chunk matches its stored
+        // copy afterwards, so it counts as saved.
+        bool read(const Pos<int32>& pos, Chunk& chunk) {
+            RegionFile* region = region_for(pos, false);
+            std::string payload;
+            if (not region or not region->read(index_of(pos), payload)) return false;
+
+            std::istringstream is(payload);
+            const Pos<int32> stored_pos = SaveFile::read_chunk_pos(is);
+            if (stored_pos.x != pos.x or stored_pos.z != pos.z) return false;
+            if (not SaveFile::read_chunk(is, chunk)) return false;
+
+            chunk.mark_saved(chunk.edits.load(std::memory_order_acquire));
+            return true;
+        }
+
+        // Leaves the saved edit count to the caller, which may be writing a snapshot in place of the chunk itself
+        bool write(const Pos<int32>& pos, const Chunk& chunk) {
+            std::ostringstream os;
+            SaveFile::write_chunk(os, pos, chunk);
+
+            RegionFile* region = region_for(pos, true);
+            return region and region->write(index_of(pos), os.str());
+        }
+
+        // Brings a stored chunk back as if its terrain job had just committed: structure blocks that neighbours
+        // queued for it while it was away are merged, which leaves it unsaved, and it is marked generated under the
+        // pending-writes lock.
+        bool restore(const Pos<int32>& pos, Chunk& chunk, PendingWrites& pending) {
+            if (not read(pos, chunk)) return false;
+
+            finish_restore(pos, chunk, pending);
+            return true;
+        }
+
+        // The part of restore() after the chunk has its stored content, from wherever it came
+        static none finish_restore(const Pos<int32>& pos, Chunk& chunk, PendingWrites& pending) {
+            pending.drain(pos, [&](const std::vector<PendingBlock>& incoming) {
+                if (not incoming.empty()) chunk.apply_pending(incoming);
+                chunk.mark_loaded();
+            });
+        }
+
+        // Every stored chunk, found by listing the directory; for loading and tools, not per frame
+        std::vector<Pos<int32>> positions() {
+            std::vector<Pos<int32>> result;
+            std::error_code error;
+            if (directory.empty() or not std::filesystem::is_directory(directory, error)) return result;
+
+            for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+                int32 rx = 0, rz = 0;
+                const std::string name = entry.path().filename().string();
+                if (std::sscanf(name.c_str(), "r.%d.%d.cbregion", &rx, &rz) != 2) continue;
+
+                const Pos<int32> first(rx * RegionFile::SIZE, 0, rz * RegionFile::SIZE);
+                RegionFile* region = region_for(first, false);
+                if (not region) continue;
+
+                for (const size index : region->indices()) {
+                    result.emplace_back(first.x + static_cast<int32>(index % RegionFile::SIZE), 0, first.z + static_cast<int32>(index / RegionFile::SIZE));
+                }
+            }
+            return result;
+        }
+
+        size open_count() const {
+            std::lock_guard lock(mutex);
+            size count = 0;
+            for (const auto& [region, file] : regions) count += file != nullptr;
+            return count;
+        }
+
+        // Size of the open files
+        uint64 bytes() const {
+            std::lock_guard lock(mutex);
+            uint64 total = 0;
+            for (const auto& [region, file] : regions) {
+                if (file) total += file->bytes();
+            }
+            return total;
+        }
+
+        // Syncs every open file, and the directory so newly created files survive too
+        bool sync() {
+            std::vector<RegionFile*> files;
+            {
+                std::lock_guard lock(mutex);
+                for (const auto& [region, file] : regions) {
+                    if (file) files.push_back(file.get());
+                }
+            }
+            if (files.empty()) return true;
+
+            bool synced = true;
+            for (RegionFile* file : files) synced = file->sync() and synced;
+            return SaveFile::sync(directory) and synced;
+        }
+    };
+}
@@ -0,0 +1,242 @@
+module;
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <includes.hpp>
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <filesystem>
+#include <shared_mutex>
+
+export module game.world.save;
+
+import misc.pos;
+import misc.dict;
+import misc.range;
+import misc.number;
+import game.core;
+import game.block;
+import game.world.chunk;
+
+export namespace craftbuild {
+    // Layout of overworld.cbsave:
+    //   header  : version string, seed, format marker + format version, chunk count
+    //   chunks  : position, block array, palettes, complex blocks
+    //   sections: (id, byte length, payload) until end of file
+    // From format 3 the chunk count is 0 and chunks live in region files next to the save (see RegionFile).
+    // Format 1 saves have no marker and end with the raw player record and pending writes.
+    enum class SaveSection : uint32 {
+        PLAYER = 1,
+        PENDING_WRITES = 2,
+    };
+
+    struct SaveHeader {
+        inline static constexpr uint32 FORMAT_MARKER = 0xFFFFFFFFu;
+        inline static constexpr uint32 FORMAT_VERSION = 3;
+
+        std::string version;
+        uint32 seed = 0;
+        uint32 format = FORMAT_VERSION;
+        uint32 chunk_count = 0;
+    };
+
+    struct SaveFile {
+        static none write_header(std::ostream& os, uint32 seed, uint32 chunk_count) {
+            size version_len = strlen(version);
+            os.write(reinterpret_cast<const byte*>(&version_len), sizeof(size));
+            os.write(version, sizeof(char) * version_len);
+
+            os.write(reinterpret_cast<const byte*>(&seed), sizeof(uint32));
+
+            const uint32 marker = SaveHeader::FORMAT_MARKER;
+            const uint32 format = SaveHeader::FORMAT_VERSION;
+            os.write(reinterpret_cast<const byte*>(&marker), sizeof(uint32));
+            os.write(reinterpret_cast<const byte*>(&format), sizeof(uint32));
+
+            os.write(reinterpret_cast<const byte*>(&chunk_count), sizeof(uint32));
+        }
+
+        static bool read_header(std::istream& is, SaveHeader& header) {
+            size version_len = 0;
+            is.read(reinterpret_cast<byte*>(&version_len), sizeof(size));
+            if (not is or version_len > 256) return false;
+
+            header.version.resize(version_len);
+            is.read(header.version.data(), sizeof(char) * version_len);
+
+            is.read(reinterpret_cast<byte*>(&header.seed), sizeof(uint32));
+
+            uint32 value = 0;
+            is.read(reinterpret_cast<byte*>(&value), sizeof(uint32));
+            if (value == SaveHeader::FORMAT_MARKER) {
+                is.read(reinterpret_cast<byte*>(&header.format), sizeof(uint32));
+                is.read(reinterpret_cast<byte*>(&header.chunk_count), sizeof(uint32));
+            }
+            else {
+                header.format = 1;
+                header.chunk_count = value;
+            }
+
+            return static_cast<bool>(is);
+        }
+
+        static none write_chunk(std::ostream& os, const Pos<int32>& pos, const Chunk& chunk) {
+            std::shared_lock data_lock(chunk.data_mutex);
+
+            os.write(reinterpret_cast<const byte*>(&pos.x), sizeof(int32));
+            os.write(reinterpret_cast<const byte*>(&pos.y), sizeof(int32));
+            os.write(reinterpret_cast<const byte*>(&pos.z), sizeof(int32));
+
+            const auto* data = &chunk.blocks[0][0][0];
+            os.write(reinterpret_cast<const byte*>(data), Chunk::SIZE_X * Chunk::SIZE_Y * Chunk::SIZE_Z * sizeof(BlockStorage));
+
+            uint8 block_ids_size = static_cast<uint8>(chunk.block_ids.size());
+            os.write(reinterpret_cast<const byte*>(&block_ids_size), sizeof(uint8));
+            for (const auto& [local_id, global_id] : chunk.block_ids) {
+                os.write(reinterpret_cast<const byte*>(&local_id), sizeof(uint8));
+                os.write(reinterpret_cast<const byte*>(&global_id), sizeof(uint32));
+            }
+
+            uint8 tag_ids_size = static_cast<uint8>(chunk.tag_ids.size());
+            os.write(reinterpret_cast<const byte*>(&tag_ids_size), sizeof(uint8));
+            for (const auto& [local_id, global_id] : chunk.tag_ids) {
+                os.write(reinterpret_cast<const byte*>(&local_id), sizeof(uint8));
+                os.write(reinterpret_cast<const byte*>(&global_id.first), sizeof(uint32));
+                os.write(reinterpret_cast<const byte*>(&global_id.second), sizeof(size));
+            }
+
+            uint32 complex_size = static_cast<uint32>(chunk.complex_blocks.size());
+            os.write(reinterpret_cast<const byte*>(&complex_size), sizeof(uint32));
+
+            for (const auto& pair : chunk.complex_blocks) {
+                os.write(reinterpret_cast<const byte*>(&pair.first.x), sizeof(uint8));
+                os.write(reinterpret_cast<const byte*>(&pair.first.y), sizeof(uint8));
+                os.write(reinterpret_cast<const byte*>(&pair.first.z), sizeof(uint8));
+
+                os.write(reinterpret_cast<const byte*>(&pair.second.block_id), sizeof(uint32));
+                os.write(reinterpret_cast<const byte*>(&pair.second.tag), sizeof(uint32));
+            }
+        }
+
+        static Pos<int32> read_chunk_pos(std::istream& is) {
+            Pos<int32> pos{ 0, 0, 0 };
+            is.read(reinterpret_cast<byte*>(&pos.x), sizeof(int32));
+            is.read(reinterpret_cast<byte*>(&pos.y), sizeof(int32));
+            is.read(reinterpret_cast<byte*>(&pos.z), sizeof(int32));
+            return pos;
+        }
+
+        // Reads the chunk body that follows read_chunk_pos(); the chunk flags are left to the caller.
+        static bool read_chunk(std::istream& is, Chunk& chunk) {
+            std::unique_lock data_lock(chunk.data_mutex);
+
+            const uint32 block_bytes = Chunk::SIZE_X * Chunk::SIZE_Y * Chunk::SIZE_Z * sizeof(BlockStorage);
+            is.read(reinterpret_cast<byte*>(&chunk.blocks[0][0][0]), block_bytes);
+
+            chunk.block_ids.clear();
+            uint8 block_ids_size = 0;
+            is.read(reinterpret_cast<byte*>(&block_ids_size), sizeof(uint8));
+            for (auto j : range<uint8>(block_ids_size)) {
+                uint8 local_id;
+                uint32 global_id;
+                is.read(reinterpret_cast<byte*>(&local_id), sizeof(uint8));
+                is.read(reinterpret_cast<byte*>(&global_id), sizeof(uint32));
+                chunk.block_ids[local_id] = global_id;
+            }
+
+            chunk.tag_ids.clear();
+            uint8 tag_ids_size = 0;
+            is.read(reinterpret_cast<byte*>(&tag_ids_size), sizeof(uint8));
+            for (auto j : range<uint8>(tag_ids_size)) {
+                uint8 local_id;
+                std::pair<uint32, size> global_id;
+                is.read(reinterpret_cast<byte*>(&local_id), sizeof(uint8));
+                is.read(reinterpret_cast<byte*>(&global_id.first), sizeof(uint32));
+                is.read(reinterpret_cast<byte*>(&global_id.second), sizeof(size));
+                chunk.tag_ids[local_id] = global_id;
+            }
+
+            chunk.complex_blocks.clear();
+            uint32 complex_size = 0;
+            is.read(reinterpret_cast<byte*>(&complex_size), sizeof(uint32));
+
+            for (auto j : range<uint32>(complex_size)) {
+                uint8 x, y, z;
+                uint32 block_id, tag;
+
+                is.read(reinterpret_cast<byte*>(&x), sizeof(uint8));
+                is.read(reinterpret_cast<byte*>(&y), sizeof(uint8));
+                is.read(reinterpret_cast<byte*>(&z), sizeof(uint8));
+
+                is.read(reinterpret_cast<byte*>(&block_id), sizeof(uint32));
+                is.read(reinterpret_cast<byte*>(&tag), sizeof(uint32));
+
+                Pos<uint8> key{ x, y, z };
+                BlockStorageFull value{ block_id, tag };
+
+                chunk.complex_blocks.emplace(key, value);
+            }
+
+            return static_cast<bool>(is);
+        }
+
+        static none write_section(std::ostream& os, SaveSection id, const std::string& payload) {
+            const uint32 raw_id = static_cast<uint32>(id);
+            const uint64 length = payload.size();
+            os.write(reinterpret_cast<const byte*>(&raw_id), sizeof(uint32));
+            os.write(reinterpret_cast<const byte*>(&length), sizeof(uint64));
+            os.write(payload.data(), static_cast<std::streamsize>(length));
+        }
+
+        // Unknown sections are returned as well, so a tool can carry them over untouched.
+        static std::vector<std::pair<SaveSection, std::string>> read_sections(std::istream& is) {
+            std::vector<std::pair<SaveSection, std::string>> sections;
+
+            while (is.peek() != std::char_traits<char>::eof()) {
+                uint32 raw_id = 0;
+                uint64 length = 0;
+                is.read(reinterpret_cast<byte*>(&raw_id), sizeof(uint32));
+                is.read(reinterpret_cast<byte*>(&length), sizeof(uint64));
+                if (not is) break;
+
+                std::string payload(length, '\0');
+                is.read(payload.data(), static_cast<std::streamsize>(length));
+                if (not is) break;
+
+                sections.emplace_back(static_cast<SaveSection>(raw_id), std::move(payload));
+            }
+
+            return sections;
+        }
+
+        // Asks the OS to put what was written to path on the disk; streams only hand it to the OS. Works on files
+        // other handles still have open, and on directories, which makes a rename durable, where the OS allows it.
+        static bool sync(const std::filesystem::path& path) {
+#if defined(_WIN32)
+            if (std::filesystem::is_directory(path)) return true;
+            HANDLE handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (handle == INVALID_HANDLE_VALUE) return false;
+            const bool synced = FlushFileBuffers(handle) != 0;
+            CloseHandle(handle);
+            return synced;
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            const bool synced = ::fsync(fd) == 0;
+            ::close(fd);
+            return synced;
+#endif
+        }
+    };
+}
@@ -0,0 +1,339 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <system_error>
+#include <condition_variable>
+
+export module game.world.save_service;
+
+import misc.ptr;
+import misc.pos;
+import misc.dict;
+import misc.number;
+import misc.format;
+import game.logger;
+import game.thread;
+import game.world.save;
+import game.world.chunk;
+import game.world.region;
+import game.world.pending_writes;
+
+export namespace craftbuild {
+    // A chunk as it was when the save was asked for
+    struct ChunkSnapshot {
+        Pos<int32> pos;
+        IPtr<Chunk> source;     // Marked saved once the copy is on disk
+        IPtr<Chunk> copy;       // Pooled, content only
+        uint32 edits = 0;       // source's edit count when it was copied
+    };
+
+    // Everything one save writes, copied on the main thread so the writer never touches live state
+    struct WorldSnapshot {
+        std::filesystem::path path;
+        uint32 seed = 0;
+        std::vector<std::pair<SaveSection, std::string>> sections;
+        std::vector<ChunkSnapshot> chunks;
+    };
+
+    struct SaveStats {
+        size saves = 0;
+        size chunks = 0;            // Written by the last save
+        float64 seconds = 0.0;      // Taken by the last save, on the writer thread
+        bool failed = false;        // Some part of the last save was not written
+        size unloaded = 0;          // Chunks written behind unloads, in total
+        size queued = 0;            // Unloaded chunks not on disk yet
+    };
+
+    // Writes saves on a thread of its own. The caller only copies what changed, which is a memcpy per modified
+    // chunk; serialising, the region writes and the syncs happen here. A save asked for while another is still
+    // queued is merged into it, so a slow disk delays saves instead of piling them up.
+    // Modified chunks that are unloaded are handed over whole and written behind: they wait a moment so one batch
+    // and one sync cover many, and a chunk unloaded again before its write keeps a single entry. The queue holds at
+    // most MAX_BEHIND chunks; past that, write_behind() turns chunks down and the caller retries them once the
+    // written callback reports a batch done. Until a chunk is written, restore() takes it from the queue, so the
+    // region files are never read behind it.
+    // Every chunk written to a region file goes through this class, one at a time.
+    class SaveService {
+    public:
+        inline static constexpr size MAX_BEHIND = 256;     // About 130 KiB each, plus palettes
+        inline static constexpr size BEHIND_BATCH = 64;    // Written without waiting any longer
+        inline static constexpr auto BEHIND_DELAY = std::chrono::seconds(2);
+
+    private:
+        RegionStore& regions;
+
+        std::deque<WorldSnapshot> queue;    // At most one waiting save besides the one being written
+        Dict<Pos<int32>, IPtr<Chunk>> behind;       // Unloaded chunks, one per position
+        Dict<Pos<int32>, IPtr<Chunk>> in_flight;    // The batch being written
+        bool stopping = false;
+        bool writing = false;
+        size flushing = 0;                  // Callers in flush(); the batch delay is skipped for them
+        std::function<none()> on_written;   // After each write-behind batch, on the save thread and under the lock
+        SaveStats stats;
+        mutable std::mutex mutex;
+        std::condition_variable cv;         // Work queued, or the writer finished a save or a batch
+
+        std::mutex write_mutex;
+        std::thread thread;                 // Last, so it starts after everything above
+
+        // Skips content no newer than what source already has stored, so a snapshot that lost the race against an
+        // unload never puts older content back.
+        bool write_locked(const Pos<int32>& pos, Chunk& source, const Chunk& content, uint32 edits) {
+            if (static_cast<int32>(source.saved_edits.load(std::memory_order_acquire) - edits) >= 0) return true;
+            if (not regions.write(pos, content)) return false;
+
+            source.mark_saved(edits);
+            return true;
+        }
+
+        // The newer copy of a chunk wins; chunks only the older save has are kept
+        static none merge(WorldSnapshot& older, WorldSnapshot&& newer) {
+            Dict<Pos<int32>, bool> updated;
+            for (const auto& chunk : newer.chunks) updated[chunk.pos] = true;
+            for (auto& chunk : older.chunks) {
+                if (not updated.contains(chunk.pos)) newer.chunks.push_back(std::move(chunk));
+            }
+            older = std::move(newer);
+        }
+
+        bool write(WorldSnapshot& snapshot) {
+            bool written = true;
+            size chunk_count = 0;
+            {
+                std::lock_guard lock(write_mutex);
+                for (auto& chunk : snapshot.chunks) {
+                    if (write_locked(chunk.pos, chunk.source.value(), chunk.copy.value(), chunk.edits)) ++chunk_count;
+                    else {
+                        log<LogType::ERROR>(format{} << "Cannot write chunk (" << chunk.pos.x << ", " << chunk.pos.z << ")");
+                        written = false;
+                    }
+                }
+                if (not regions.sync()) {
+                    log<LogType::ERROR>("Cannot sync region files");
+                    written = false;
+                }
+            }
+            // Back to the pool here rather than on whichever thread drops the last reference
+            snapshot.chunks.clear();
+
+            // The save file is replaced whole, so a crash leaves either the old one or the new one
+            std::error_code error;
+            std::filesystem::create_directories(snapshot.path.parent_path(), error);
+            std::filesystem::path temp_path = snapshot.path;
+            temp_path += ".tmp";
+            {
+                std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+                if (not ofs.is_open()) {
+                    log<LogType::ERROR>(format{} << "Cannot open save file: " << temp_path.string());
+                    return false;
+                }
+
+                SaveFile::write_header(ofs, snapshot.seed, 0);
+                for (const auto& [id, payload] : snapshot.sections) SaveFile::write_section(ofs, id, payload);
+                if (not ofs.flush()) return false;
+            }
+            if (not SaveFile::sync(temp_path)) return false;
+
+            std::filesystem::rename(temp_path, snapshot.path, error);
+            if (error) {
+                log<LogType::ERROR>(format{} << "Cannot replace save file: " << snapshot.path.string());
+                return false;
+            }
+            SaveFile::sync(snapshot.path.parent_path());
+
+            std::lock_guard lock(mutex);
+            stats.chunks = chunk_count;
+            return written;
+        }
+
+        // Chunks that fail are queued again, unless someone is waiting for the queue to empty: a disk that keeps
+        // failing would make them wait forever
+        none write_behind(Dict<Pos<int32>, IPtr<Chunk>>& batch) {
+            std::vector<std::pair<Pos<int32>, IPtr<Chunk>>> failed;
+            size written = 0;
+            {
+                std::lock_guard lock(write_mutex);
+                for (auto& [pos, chunk] : batch) {
+                    if (write_locked(pos, chunk.value(), chunk.value(), chunk.value().edits.load(std::memory_order_acquire))) ++written;
+                    else failed.emplace_back(pos, chunk);
+                }
+                if (not regions.sync()) log<LogType::ERROR>("Cannot sync region files");
+            }
+
+            std::lock_guard lock(mutex);
+            stats.unloaded += written;
+            for (auto& [pos, chunk] : failed) {
+                if (stopping or flushing != 0) log<LogType::ERROR>(format{} << "Cannot write unloaded chunk (" << pos.x << ", " << pos.z << "), its changes are lost");
+                else {
+                    log<LogType::ERROR>(format{} << "Cannot write unloaded chunk (" << pos.x << ", " << pos.z << "), retrying");
+                    behind.try_emplace(pos, std::move(chunk));
+                }
+            }
+        }
+
+        none run() {
+            ThreadRegistry::register_thread("Save");
+            lower_current_thread_priority();
+
+            std::unique_lock lock(mutex);
+            while (true) {
+                cv.wait(lock, [this]() { return stopping or not queue.empty() or not behind.empty(); });
+
+                if (not queue.empty()) {
+                    WorldSnapshot snapshot = std::move(queue.front());
+                    queue.pop_front();
+                    writing = true;
+                    lock.unlock();
+
+                    const auto start = std::chrono::steady_clock::now();
+                    const bool written = write(snapshot);
+                    const float64 seconds = std::chrono::duration<float64>(std::chrono::steady_clock::now() - start).count();
+                    if (written) log<LogType::INFO>("World saved!");
+                    else log<LogType::ERROR>("World save incomplete");
+
+                    lock.lock();
+                    writing = false;
+                    ++stats.saves;
+                    stats.seconds = seconds;
+                    stats.failed = not written;
+                    cv.notify_all();
+                    continue;
+                }
+                if (behind.empty()) return;
+
+                // Gives more unloads a chance to join the batch
+                cv.wait_for(lock, BEHIND_DELAY, [this]() {
+                    return stopping or flushing != 0 or not queue.empty() or behind.size() >= BEHIND_BATCH;
+                });
+                in_flight.swap(behind);
+                Dict<Pos<int32>, IPtr<Chunk>> batch = in_flight;
+                lock.unlock();
+
+                write_behind(batch);
+                // Back to the pool here rather than on whichever thread drops the last reference
+                batch.clear();
+
+                lock.lock();
+                in_flight.clear();
+                cv.notify_all();
+                if (on_written) on_written();
+            }
+        }
+
+    public:
+        explicit SaveService(RegionStore& regions) : regions(regions), thread([this]() { run(); }) {}
+
+        // Writes whatever is still queued first
+        ~SaveService() {
+            stop();
+        }
+
+        SaveService(const SaveService&) = delete;
+        SaveService& operator=(const SaveService&) = delete;
+
+        // Copies the chunk's content into a pooled chunk; takes its lock only for the copy.
+        static ChunkSnapshot snapshot(const Pos<int32>& pos, const IPtr<Chunk>& chunk) {
+            IPtr<Chunk> copy = ChunkPool::acquire();
+            copy.value().chunk_pos = Pos<int32>(pos.x, 0, pos.z);
+            const uint32 edits = chunk.value().edits.load(std::memory_order_acquire);
+            copy.value().copy_content(chunk.value());
+            return { pos, chunk, std::move(copy), edits };
+        }
+
+        none submit(WorldSnapshot&& snapshot) {
+            std::lock_guard lock(mutex);
+            if (stopping) return;
+            if (not queue.empty()) merge(queue.back(), std::move(snapshot));
+            else queue.push_back(std::move(snapshot));
+            cv.notify_all();
+        }
+
+        // Takes a chunk that is being unloaded. It may still be in the chunk map and change until the main thread drops
+        // it; the write stores whatever it holds by then, and anything later leaves it unsaved for the next save.
+        // Returns false, leaving the chunk alone, when the queue is full.
+        bool write_behind(const Pos<int32>& pos, const IPtr<Chunk>& chunk) {
+            std::lock_guard lock(mutex);
+            if (stopping) return false;
+
+            auto it = behind.find(pos);
+            if (it != behind.end()) it->second = chunk;
+            else {
+                if (behind.size() + in_flight.size() >= MAX_BEHIND) return false;
+                behind.emplace(pos, chunk);
+            }
+            cv.notify_all();
+            return true;
+        }
+
+        // Like RegionStore::restore(), but a chunk still waiting to be written is taken from the queue instead. The
+        // chunk then carries those changes as unsaved, and the queued copy is dropped.
+        bool restore(const Pos<int32>& pos, Chunk& chunk, PendingWrites& pending) {
+            IPtr<Chunk> queued = nullptr;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [&]() { return not in_flight.contains(pos); });
+
+                auto it = behind.find(pos);
+                if (it != behind.end()) {
+                    queued = std::move(it->second);
+                    behind.erase(it);
+                }
+            }
+            if (not queued) return regions.contains(pos) and regions.restore(pos, chunk, pending);
+
+            chunk.copy_content(queued.value());
+            chunk.mark_modified();
+            RegionStore::finish_restore(pos, chunk, pending);
+            return true;
+        }
+
+        // Called on the save thread after each batch of unloaded chunks, so chunks turned down by a full queue can be
+        // offered again. It runs under the service's lock, so it must be short and must not call back in; once this
+        // returns, the previous callback is not running and never runs again.
+        none set_on_written(std::function<none()> callback) {
+            std::lock_guard lock(mutex);
+            on_written = std::move(callback);
+        }
+
+        // Waits until everything submitted so far is on disk, unloaded chunks included
+        none flush() {
+            std::unique_lock lock(mutex);
+            ++flushing;
+            cv.notify_all();
+            cv.wait(lock, [this]() { return queue.empty() and behind.empty() and in_flight.empty() and not writing; });
+            --flushing;
+        }
+
+        none stop() {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+                cv.notify_all();
+            }
+            if (thread.joinable()) thread.join();
+        }
+
+        // A world save is queued or being written; unloads written behind do not count
+        bool busy() const {
+            std::lock_guard lock(mutex);
+            return writing or not queue.empty();
+        }
+
+        SaveStats get_stats() const {
+            std::lock_guard lock(mutex);
+            SaveStats result = stats;
+            result.queued = behind.size() + in_flight.size();
+            return result;
+        }
+    };
+}
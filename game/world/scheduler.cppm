@@ -0,0 +1,247 @@
+module;
+
+#include <includes.hpp>
+
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <condition_variable>
+
+export module game.world.scheduler;
+
+import misc.pos;
+import misc.range;
+import misc.number;
+import misc.hasher;
+
+export namespace craftbuild {
+    // Orders chunk work by distance from the player, with chunks behind the camera counted up to twice as far.
+    // A moving player is scheduled ahead of time: the loaded area is stretched toward where the player will be a
+    // few seconds from now, and chunks along that path count as close.
+    // Only positions that may need work are queued: the strip that enters the loaded area when the player
+    // crosses a chunk border, and whatever request() is called for afterwards (a chunk turned dirty, a job ended).
+    // Chunks that are done are not looked at again, so a tick costs only as much as the work that changed.
+    // The scheduler thread sleeps in wait() until a request() queues something new or wake() is called.
+    class ChunkScheduler {
+    public:
+        inline static constexpr float32 VIEW_PENALTY = 1.0f;    // Extra distance factor straight behind the camera
+        inline static constexpr float32 CLOSE_RADIUS = 1.5f;    // Chunks this close ignore the view direction
+        inline static constexpr int32 VIEW_SECTORS = 16;        // Turning within one sector keeps the current order
+        inline static constexpr float32 LOOKAHEAD_SECONDS = 3.0f;
+        inline static constexpr float32 MIN_LEAD_SPEED = 0.25f; // Chunks per second; slower players steer by the view only
+        inline static constexpr int32 MAX_LEAD = 4;             // Chunks; unloading keeps this much slack past the render distance
+
+        // The loaded area: the square around the player plus the same square moved by the lead
+        struct Area {
+            int32 center_x = 0;
+            int32 center_z = 0;
+            int32 lead_x = 0;
+            int32 lead_z = 0;
+            int32 radius = 0;
+
+            bool contains(const Pos<int32>& pos, int32 slack = 0) const {
+                const int32 r = radius + slack;
+                if (std::abs(pos.x - center_x) <= r and std::abs(pos.z - center_z) <= r) return true;
+                return std::abs(pos.x - center_x - lead_x) <= r and std::abs(pos.z - center_z - lead_z) <= r;
+            }
+        };
+
+        // Where the player is expected to be LOOKAHEAD_SECONDS from now, in whole chunks from the current one.
+        // (vx, vz) is in chunks per second.
+        static Pos<int32> lead_for(float32 vx, float32 vz) {
+            const float32 speed = std::sqrt(vx * vx + vz * vz);
+            if (speed < MIN_LEAD_SPEED) return Pos<int32>(0, 0, 0);
+
+            const float32 scale = std::min(LOOKAHEAD_SECONDS, static_cast<float32>(MAX_LEAD) / speed);
+            return Pos<int32>(static_cast<int32>(std::round(vx * scale)), 0, static_cast<int32>(std::round(vz * scale)));
+        }
+
+    private:
+        struct Entry {
+            float32 key;
+            Pos<int32> pos;
+
+            // std heap functions build a max-heap; invert so the nearest chunk is on top
+            bool operator<(const Entry& other) const {
+                return key > other.key;
+            }
+        };
+
+        std::vector<Entry> heap;
+        std::unordered_set<Pos<int32>, Hasher<Pos<int32>>> queued;
+        mutable std::mutex mutex;
+        std::condition_variable wake_cv;
+        bool woken = false;
+
+        bool has_center = false;
+        Area area;
+        float32 view_x = 0.0f;      // Heading while moving, otherwise the view direction
+        float32 view_z = -1.0f;
+        int32 view_sector = 0;
+
+        bool in_range(const Pos<int32>& pos) const {
+            return area.contains(pos);
+        }
+
+        // Distance to the path from the player to the lead point, plus half the way along it, so chunks on the
+        // path are taken in the order the player reaches them. Without a lead this is the plain distance.
+        float32 key_for(const Pos<int32>& pos) const {
+            const float32 dx = static_cast<float32>(pos.x - area.center_x);
+            const float32 dz = static_cast<float32>(pos.z - area.center_z);
+            const float32 distance = std::sqrt(dx * dx + dz * dz);
+            if (distance <= CLOSE_RADIUS) return distance;
+
+            const float32 lx = static_cast<float32>(area.lead_x);
+            const float32 lz = static_cast<float32>(area.lead_z);
+            const float32 lead_squared = lx * lx + lz * lz;
+            const float32 t = lead_squared > 0.0f ? std::clamp((dx * lx + dz * lz) / lead_squared, 0.0f, 1.0f) : 0.0f;
+            const float32 ox = dx - lx * t;
+            const float32 oz = dz - lz * t;
+            const float32 off_path = std::sqrt(ox * ox + oz * oz);
+
+            const float32 cos_angle = (dx * view_x + dz * view_z) / distance;
+            return off_path * (1.0f + VIEW_PENALTY * (1.0f - cos_angle) * 0.5f) + 0.5f * t * std::sqrt(lead_squared);
+        }
+
+        bool push(const Pos<int32>& pos) {
+            if (not queued.insert(pos).second) return false;
+            heap.push_back({ key_for(pos), pos });
+            std::push_heap(heap.begin(), heap.end());
+            return true;
+        }
+
+        none push_column(int32 x, int32 z_begin, int32 z_end) {
+            for (auto z : range<int32>(z_begin, z_end + 1)) push(Pos<int32>(x, 0, z));
+        }
+
+        // Queues every position of the square around (new_x, new_z) that was outside the one around (old_x, old_z)
+        none push_entered(int32 new_x, int32 new_z, int32 old_x, int32 old_z) {
+            const int32 radius = area.radius;
+            const bool overlap = std::abs(new_x - old_x) <= 2 * radius and std::abs(new_z - old_z) <= 2 * radius;
+
+            for (auto x : range<int32>(new_x - radius, new_x + radius + 1)) {
+                if (not overlap or x < old_x - radius or x > old_x + radius) {
+                    push_column(x, new_z - radius, new_z + radius);
+                    continue;
+                }
+                push_column(x, new_z - radius, std::min(new_z + radius, old_z - radius - 1));
+                push_column(x, std::max(new_z - radius, old_z + radius + 1), new_z + radius);
+            }
+        }
+
+        // Recomputes every key and drops what left the square
+        none rekey() {
+            std::erase_if(heap, [this](const Entry& entry) {
+                if (in_range(entry.pos)) return false;
+                queued.erase(entry.pos);
+                return true;
+            });
+            for (auto& entry : heap) entry.key = key_for(entry.pos);
+            std::make_heap(heap.begin(), heap.end());
+        }
+
+    public:
+        // Call once per scheduler tick. (cx, cz) is the player's chunk, (fx, fz) the horizontal view direction and
+        // (vx, vz) the horizontal velocity in chunks per second. Returns true when the order changed.
+        bool update(int32 cx, int32 cz, float32 fx, float32 fz, float32 vx, float32 vz, int32 r) {
+            std::lock_guard lock(mutex);
+
+            const Pos<int32> lead = lead_for(vx, vz);
+            if (lead.x != 0 or lead.z != 0) {
+                fx = vx;
+                fz = vz;
+            }
+
+            const float32 length = std::sqrt(fx * fx + fz * fz);
+            const float32 angle = length > 0.0f ? std::atan2(fz, fx) : std::atan2(view_z, view_x);
+            const int32 sector = static_cast<int32>(std::floor((angle + 3.14159265f) / (6.28318531f / VIEW_SECTORS))) % VIEW_SECTORS;
+
+            const bool moved = not has_center or cx != area.center_x or cz != area.center_z or r != area.radius;
+            const bool led = lead.x != area.lead_x or lead.z != area.lead_z;
+            if (not moved and not led and sector == view_sector) return false;
+
+            if (length > 0.0f) {
+                view_x = fx / length;
+                view_z = fz / length;
+            }
+            view_sector = sector;
+
+            const Area old = area;
+            const bool refill = not has_center or r != area.radius;
+            area = { cx, cz, lead.x, lead.z, std::max(r, 0) };
+            has_center = true;
+
+            rekey();
+            if (refill) {
+                for (auto x : range<int32>(cx - area.radius, cx + area.radius + 1)) push_column(x, cz - area.radius, cz + area.radius);
+                if (lead.x != 0 or lead.z != 0) push_entered(cx + lead.x, cz + lead.z, cx, cz);
+            }
+            else if (moved or led) {
+                push_entered(cx, cz, old.center_x, old.center_z);
+                push_entered(cx + lead.x, cz + lead.z, old.center_x + old.lead_x, old.center_z + old.lead_z);
+            }
+            return true;
+        }
+
+        Area get_area() const {
+            std::lock_guard lock(mutex);
+            return area;
+        }
+
+        // Queues a chunk for another look and wakes the scheduler thread. Positions outside the loaded area are ignored.
+        none request(const Pos<int32>& pos) {
+            {
+                std::lock_guard lock(mutex);
+                if (not has_center or not in_range(pos) or not push(pos)) return;
+                woken = true;
+            }
+            wake_cv.notify_one();
+        }
+
+        // For events the queue cannot see: the player moved or turned, a job slot freed up, shutdown.
+        none wake() {
+            {
+                std::lock_guard lock(mutex);
+                woken = true;
+            }
+            wake_cv.notify_one();
+        }
+
+        // Blocks until the next request() or wake(), without a timeout.
+        none wait() {
+            std::unique_lock lock(mutex);
+            wake_cv.wait(lock, [this]() { return woken; });
+            woken = false;
+        }
+
+        // Takes the most urgent position. The caller decides what, if anything, the chunk needs.
+        bool pop(Pos<int32>& pos) {
+            std::lock_guard lock(mutex);
+            while (not heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end());
+                const Entry entry = heap.back();
+                heap.pop_back();
+                queued.erase(entry.pos);
+
+                if (not in_range(entry.pos)) continue;
+                pos = entry.pos;
+                return true;
+            }
+            return false;
+        }
+
+        size pending() const {
+            std::lock_guard lock(mutex);
+            return heap.size();
+        }
+
+        none clear() {
+            std::lock_guard lock(mutex);
+            heap.clear();
+            queued.clear();
+            has_center = false;
+        }
+    };
+}
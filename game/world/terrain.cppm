@@ -3,7 +3,7 @@ module;
 #include <includes.hpp>
 
 #include <algorithm>
-#include <random>
+#include <limits>
 #include <stdexcept>
 
 export module game.world.terrain;
@@ -21,23 +21,81 @@ export namespace craftbuild {
         }
     };
 
+    // Counter-based generator (SplitMix64 over a position counter): 16 bytes of state, no seeding cost,
+    // and any draw can be reached directly with seek() or derived from a position with at().
     class RandomSource {
     private:
-        std::mt19937 generator;
+        inline static constexpr uint64 GAMMA = 0x9e3779b97f4a7c15ull;
+
+        uint64 seed;
+        uint64 counter = 0;
 
     public:
-        explicit RandomSource(uint32 seed) : generator(seed) {}
+        explicit RandomSource(uint64 seed) : seed(mix(seed)) {}
+
+        static uint64 mix(uint64 value) {
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+            return value ^ (value >> 31);
+        }
+
+        static uint64 hash(uint64 seed, int32 x, int32 y, int32 z) {
+            uint64 h = mix(seed + GAMMA);
+            h = mix(h ^ (static_cast<uint64>(static_cast<uint32>(x)) * GAMMA));
+            h = mix(h ^ (static_cast<uint64>(static_cast<uint32>(y)) * 0xc2b2ae3d27d4eb4full));
+            h = mix(h ^ (static_cast<uint64>(static_cast<uint32>(z)) * 0x165667b19e3779f9ull));
+            return h;
+        }
+
+        static RandomSource at(uint64 seed, int32 x, int32 y, int32 z) {
+            return RandomSource(hash(seed, x, y, z));
+        }
+
+        RandomSource fork(uint64 salt) const {
+            return RandomSource(seed ^ mix(salt + GAMMA));
+        }
+
+        none seek(uint64 position) {
+            counter = position;
+        }
+
+        uint64 position() const {
+            return counter;
+        }
+
+        uint64 next_uint64() {
+            return mix(seed + ++counter * GAMMA);
+        }
+
+        uint32 next_uint32() {
+            return static_cast<uint32>(next_uint64() >> 32);
+        }
 
         int32 next_int(int32 bound) {
             if (bound <= 0) throw std::invalid_argument("RandomSource::next_int bound must be positive");
-            std::uniform_int_distribution<int32> distribution(0, bound - 1);
-            return distribution(generator);
+
+            // Lemire's multiply-shift with rejection of the biased low range
+            const uint32 range = static_cast<uint32>(bound);
+            uint64 product = static_cast<uint64>(next_uint32()) * range;
+            uint32 low = static_cast<uint32>(product);
+            if (low < range) {
+                const uint32 threshold = (0u - range) % range;
+                while (low < threshold) {
+                    product = static_cast<uint64>(next_uint32()) * range;
+                    low = static_cast<uint32>(product);
+                }
+            }
+            return static_cast<int32>(product >> 32);
         }
 
         int32 next_int(int32 min_inclusive, int32 max_inclusive) {
             if (min_inclusive > max_inclusive) return min_inclusive;
-            std::uniform_int_distribution<int32> distribution(min_inclusive, max_inclusive);
-            return distribution(generator);
+
+            const uint64 span = static_cast<uint64>(static_cast<int64>(max_inclusive) - min_inclusive) + 1;
+            if (span > static_cast<uint64>(std::numeric_limits<int32>::max())) {
+                return static_cast<int32>(min_inclusive + static_cast<int64>(next_uint64() % span));
+            }
+            return min_inclusive + next_int(static_cast<int32>(span));
         }
     };
 
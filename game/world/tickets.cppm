@@ -0,0 +1,174 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+export module game.world.tickets;
+
+import misc.pos;
+import misc.dict;
+import misc.number;
+
+export namespace craftbuild {
+    enum class TicketReason : uint8 {
+        PLAYER,     // Follows a player, level render distance plus the unload slack
+        SPAWN,
+        FORCED,     // From the forceload command
+        PREGEN,
+        COUNT,
+    };
+
+    inline const char* ticket_reason_name(TicketReason reason) {
+        switch (reason) {
+            case TicketReason::PLAYER: return "player";
+            case TicketReason::SPAWN: return "spawn";
+            case TicketReason::FORCED: return "forced";
+            case TicketReason::PREGEN: return "pregen";
+            default: return "unknown";
+        }
+    }
+
+    struct Ticket {
+        TicketReason reason = TicketReason::PLAYER;
+        Pos<int32> pos;
+        int32 level = 0;
+    };
+
+    // Why each chunk is loaded. A ticket of level L gives its own chunk level L and every other chunk L minus its
+    // distance (the larger axis); a chunk is held while some ticket gives it a level of 0 or more, i.e. within the
+    // square of radius L. Holders are counted per position, so adding, moving or dropping a ticket touches only
+    // the positions that entered or left its square, and whatever it stops holding is reported by take_released().
+    // What is loaded and when is up to the caller; this only keeps the books.
+    class ChunkTickets {
+        inline static constexpr size REASON_COUNT = static_cast<size>(TicketReason::COUNT);
+
+        struct Holders {
+            uint32 count[REASON_COUNT] = {};
+            uint32 total = 0;
+        };
+
+        std::unordered_map<uint64, Ticket> tickets;
+        Dict<Pos<int32>, Holders> held;
+        std::vector<Pos<int32>> released;   // Dropped to no holder since the last take; may have been taken again
+        std::vector<Pos<int32>> acquired;   // Gained a first holder other than a player, for chunks nothing else loads
+        uint64 next_id = 1;
+        mutable std::mutex mutex;
+
+        none hold(const Pos<int32>& pos, TicketReason reason) {
+            Holders& holders = held[pos];
+            if (holders.count[static_cast<size>(reason)]++ == 0 and reason != TicketReason::PLAYER) acquired.push_back(pos);
+            ++holders.total;
+        }
+
+        none drop(const Pos<int32>& pos, TicketReason reason) {
+            auto it = held.find(pos);
+            if (it == held.end()) return;
+
+            --it->second.count[static_cast<size>(reason)];
+            if (--it->second.total == 0) {
+                held.erase(it);
+                released.push_back(pos);
+            }
+        }
+
+        // Calls f for every position of the square (x, z, r) outside the square (old_x, old_z, old_r), column by
+        // column, so only the difference is visited. A negative old_r is an empty square.
+        template <typename F>
+        static none for_each_outside(int32 x, int32 z, int32 r, int32 old_x, int32 old_z, int32 old_r, F&& f) {
+            auto column = [&f](int32 cx, int32 z_begin, int32 z_end) {
+                for (int32 cz = z_begin; cz <= z_end; ++cz) f(Pos<int32>(cx, 0, cz));
+            };
+
+            for (int32 cx = x - r; cx <= x + r; ++cx) {
+                if (old_r < 0 or cx < old_x - old_r or cx > old_x + old_r) column(cx, z - r, z + r);
+                else {
+                    column(cx, z - r, std::min(z + r, old_z - old_r - 1));
+                    column(cx, std::max(z - r, old_z + old_r + 1), z + r);
+                }
+            }
+        }
+
+    public:
+        // Returns the ticket's id. A negative level holds nothing.
+        uint64 add(TicketReason reason, const Pos<int32>& pos, int32 level) {
+            std::lock_guard lock(mutex);
+            const uint64 id = next_id++;
+            tickets[id] = { reason, pos, level };
+            for_each_outside(pos.x, pos.z, level, 0, 0, -1, [&](const Pos<int32>& p) { hold(p, reason); });
+            return id;
+        }
+
+        bool remove(uint64 id) {
+            std::lock_guard lock(mutex);
+            auto it = tickets.find(id);
+            if (it == tickets.end()) return false;
+
+            const Ticket ticket = it->second;
+            tickets.erase(it);
+            for_each_outside(ticket.pos.x, ticket.pos.z, ticket.level, 0, 0, -1, [&](const Pos<int32>& p) { drop(p, ticket.reason); });
+            return true;
+        }
+
+        // Moves a ticket or changes its level. Holds what entered the square before dropping what left it, so a
+        // position covered by both never drops to zero on the way.
+        bool move(uint64 id, const Pos<int32>& pos, int32 level) {
+            std::lock_guard lock(mutex);
+            auto it = tickets.find(id);
+            if (it == tickets.end()) return false;
+
+            Ticket& ticket = it->second;
+            if (ticket.pos.x == pos.x and ticket.pos.z == pos.z and ticket.level == level) return true;
+
+            const Ticket old = ticket;
+            ticket.pos = pos;
+            ticket.level = level;
+            for_each_outside(pos.x, pos.z, level, old.pos.x, old.pos.z, old.level, [&](const Pos<int32>& p) { hold(p, old.reason); });
+            for_each_outside(old.pos.x, old.pos.z, old.level, pos.x, pos.z, level, [&](const Pos<int32>& p) { drop(p, old.reason); });
+            return true;
+        }
+
+        bool is_held(const Pos<int32>& pos) const {
+            std::lock_guard lock(mutex);
+            return held.contains(pos);
+        }
+
+        // Held for a reason other than being near a player
+        bool is_held_apart_from_players(const Pos<int32>& pos) const {
+            std::lock_guard lock(mutex);
+            auto it = held.find(pos);
+            return it != held.end() and it->second.total > it->second.count[static_cast<size>(TicketReason::PLAYER)];
+        }
+
+        // Positions that lost their last holder since the previous call. Check is_held() before acting on one.
+        std::vector<Pos<int32>> take_released() {
+            std::lock_guard lock(mutex);
+            std::vector<Pos<int32>> result;
+            result.swap(released);
+            return result;
+        }
+
+        // Positions that gained a non-player holder since the previous call
+        std::vector<Pos<int32>> take_acquired() {
+            std::lock_guard lock(mutex);
+            std::vector<Pos<int32>> result;
+            result.swap(acquired);
+            return result;
+        }
+
+        std::vector<std::pair<uint64, Ticket>> list() const {
+            std::lock_guard lock(mutex);
+            std::vector<std::pair<uint64, Ticket>> result(tickets.begin(), tickets.end());
+            std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            return result;
+        }
+
+        size held_count() const {
+            std::lock_guard lock(mutex);
+            return held.size();
+        }
+    };
+}
@@ -0,0 +1,96 @@
+module;
+
+#include <includes.hpp>
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+export module misc.arena;
+
+import misc.list;
+import misc.number;
+
+export namespace craftbuild {
+    // Bump allocator for scratch memory that only lives while one job runs. Blocks are kept when a Scope rewinds,
+    // so a thread that runs the same kind of job over and over stops allocating once its blocks are big enough.
+    // Nothing allocated here is destroyed; only use it for trivially destructible data.
+    class Arena {
+        struct Block {
+            std::unique_ptr<ubyte[]> data;
+            size capacity = 0;
+            size used = 0;
+        };
+
+        std::vector<Block> blocks;
+        size current = 0;
+
+    public:
+        inline static constexpr size BLOCK_SIZE = 256 * 1024;
+
+        // Rewinds the arena to where it was when the scope was opened
+        class Scope {
+            Arena& arena;
+            size block;
+            size used;
+
+        public:
+            explicit Scope(Arena& arena) : arena(arena), block(arena.current), used(arena.blocks.empty() ? 0 : arena.blocks[arena.current].used) {}
+
+            ~Scope() {
+                arena.current = block;
+                if (not arena.blocks.empty()) arena.blocks[block].used = used;
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        };
+
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        none* allocate(size bytes, size alignment = alignof(std::max_align_t)) {
+            for (; current < blocks.size(); ++current) {
+                Block& block = blocks[current];
+                const size offset = (block.used + alignment - 1) & ~(alignment - 1);
+                if (offset + bytes <= block.capacity) {
+                    block.used = offset + bytes;
+                    return block.data.get() + offset;
+                }
+                if (current + 1 < blocks.size()) blocks[current + 1].used = 0;
+            }
+
+            // Blocks come from new[], which is aligned for any fundamental type
+            const size capacity = std::max(BLOCK_SIZE, bytes);
+            blocks.push_back({ std::make_unique<ubyte[]>(capacity), capacity, bytes });
+            current = blocks.size() - 1;
+            return blocks.back().data.get();
+        }
+
+        // Uninitialised room for count elements
+        template <typename T>
+        T* allocate_array(size count) {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // An empty list backed by arena memory; it moves to the heap only if it outgrows capacity
+        template <typename T>
+        List<T> list(size capacity) {
+            return List<T>::borrow(allocate_array<T>(capacity), capacity);
+        }
+
+        size reserved() const {
+            size total = 0;
+            for (const auto& block : blocks) total += block.capacity;
+            return total;
+        }
+
+        // One per thread, for worker jobs
+        static Arena& local() {
+            thread_local Arena arena;
+            return arena;
+        }
+    };
+}
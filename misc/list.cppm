@@ -27,6 +27,7 @@ export namespace craftbuild {
         T* __value__;
         size __len__;
         size __space__;
+        bool __borrowed__ = false;  // __value__ belongs to someone else (an Arena) and is never deleted here
 
         struct Iterator {
             T* __ptr__;
@@ -49,10 +50,21 @@ export namespace craftbuild {
         List() : __value__(nullptr), __len__(0), __space__(0) {}
         List(const std::initializer_list<T>& l) : __value__(new T[l.size()]), __space__(l.size()), __len__(l.size()) { memcpy(__value__, l.data(), __len__ * sizeof(T)); }
         List(const List& s) : __value__(new T[s.__len__]), __len__(s.__len__), __space__(s.__len__) { memcpy(__value__, s.__value__, __len__ * sizeof(T)); }
-        List(List&& s) noexcept : __value__(s.__value__), __len__(std::move(s.__len__)), __space__(std::move(s.__space__)) {
+        List(List&& s) noexcept : __value__(s.__value__), __len__(std::move(s.__len__)), __space__(std::move(s.__space__)), __borrowed__(s.__borrowed__) {
             s.__value__ = nullptr;
             s.__len__ = 0;
             s.__space__ = 0;
+            s.__borrowed__ = false;
+        }
+
+        // An empty list that writes into buffer, which holds capacity elements and must outlive the list.
+        // Growing past capacity copies to the heap; the buffer itself is never freed by the list.
+        static List borrow(T* buffer, size capacity) {
+            List list;
+            list.__value__ = buffer;
+            list.__space__ = capacity;
+            list.__borrowed__ = true;
+            return list;
         }
 
         ~List() { clear(); }
@@ -74,9 +86,11 @@ export namespace craftbuild {
             __value__ = s.__value__;
             __len__ = std::move(s.__len__);
             __space__ = std::move(s.__space__);
+            __borrowed__ = s.__borrowed__;
             s.__value__ = nullptr;
             s.__len__ = 0;
             s.__space__ = 0;
+            s.__borrowed__ = false;
             return *this;
         }
 
@@ -155,9 +169,10 @@ export namespace craftbuild {
         }
 
         none clear() {
-            delete[] __value__;
+            if (not __borrowed__) delete[] __value__;
             __value__ = nullptr;
             __len__ = __space__ = 0;
+            __borrowed__ = false;
         }
 
         none expect(size extra) {
@@ -173,10 +188,11 @@ export namespace craftbuild {
             T* cache = new T[extra];
             if (__value__) {
                 memcpy(cache, __value__, __len__ * sizeof(T));
-                delete[] __value__;
+                if (not __borrowed__) delete[] __value__;
             }
 
             __value__ = cache;
+            __borrowed__ = false;
             cache = nullptr;
         }
 
@@ -192,6 +208,7 @@ export namespace craftbuild {
             std::swap(__value__, other.__value__);
             std::swap(__len__, other.__len__);
             std::swap(__space__, other.__space__);
+            std::swap(__borrowed__, other.__borrowed__);
         }
 
         Str str() const {
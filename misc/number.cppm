@@ -1,6 +1,5 @@
 module;
 
-#include <godot_cpp/core/math_defs.hpp>
 #include <includes.hpp>
 #include <cstdint>
 
@@ -19,6 +18,11 @@ export using ubyte = unsigned char;
 export using byte32 = char32_t;
 export using float32 = float;
 export using float64 = double;
-export using real = godot::real_t;
+// The engine's real_t, which godot-cpp makes double when built with REAL_T_IS_DOUBLE
+#ifdef REAL_T_IS_DOUBLE
+export using real = double;
+#else
+export using real = float;
+#endif
 export using size = size_t;
 export using none = void;
\ No newline at end of file
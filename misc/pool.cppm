@@ -0,0 +1,76 @@
+module;
+
+#include <includes.hpp>
+
+#include <mutex>
+#include <vector>
+
+export module misc.pool;
+
+import misc.ptr;
+import misc.number;
+
+export namespace craftbuild {
+    // Recycles objects that are expensive to build. A type opts in by deriving from RefCounted, with a reset() that
+    // puts an object back into its freshly constructed state while keeping its allocations, and a static
+    // recycle(T*) that calls release(); IPtr calls recycle() in place of delete, so the thread that drops the last
+    // reference only pays for a push.
+    // Spares past max_spare are destroyed by trim(), called from a thread where that cost does not matter.
+    template <typename T>
+    class Pool {
+        struct State {
+            std::mutex mutex;
+            std::vector<T*> spare;
+        };
+
+        // Never destroyed, so objects released during static destruction still have somewhere to go
+        static State& state() {
+            static State* instance = new State();
+            return *instance;
+        }
+
+    public:
+        inline static size max_spare = 128;
+
+        static IPtr<T> acquire() {
+            T* object = nullptr;
+            {
+                auto& pool = state();
+                std::lock_guard lock(pool.mutex);
+                if (not pool.spare.empty()) {
+                    object = pool.spare.back();
+                    pool.spare.pop_back();
+                }
+            }
+
+            if (not object) return IPtr<T>(new T());
+            object->reset();
+            return IPtr<T>(object);
+        }
+
+        static none release(T* object) {
+            auto& pool = state();
+            std::lock_guard lock(pool.mutex);
+            pool.spare.push_back(object);
+        }
+
+        // Destroys spares until at most keep are left
+        static none trim(size keep = max_spare) {
+            std::vector<T*> excess;
+            {
+                auto& pool = state();
+                std::lock_guard lock(pool.mutex);
+                if (pool.spare.size() <= keep) return;
+                excess.assign(pool.spare.begin() + keep, pool.spare.end());
+                pool.spare.resize(keep);
+            }
+            for (T* object : excess) delete object;
+        }
+
+        static size spare_count() {
+            auto& pool = state();
+            std::lock_guard lock(pool.mutex);
+            return pool.spare.size();
+        }
+    };
+}
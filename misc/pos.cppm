@@ -1,33 +1,39 @@
 module;
 
-#include <godot_cpp/variant/vector3.hpp>
-#include <godot_cpp/variant/vector3i.hpp>
-
 #include <includes.hpp>
 #include <xhash>
+#include <initializer_list>
 
 export module misc.pos;
 
 import misc.number;
 import misc.hasher;
 
-using namespace godot;
-
 template<typename T1, typename T2>
 concept AbleToCast = requires (T2 t2) {
     (T1)t2;
 };
 
+// The engine's Vector3 and Vector3i, or anything else with x, y and z members, without naming them here
+template<typename V>
+concept VectorLike = requires (const V& v) {
+    v.x;
+    v.y;
+    v.z;
+} and not requires { typename V::Component; };
+
 export namespace craftbuild {
     template <typename T>
     requires std::is_arithmetic_v<T>
     struct Pos {
+        using Component = T;
+
         T x, y, z;
 
         Pos() = default;
         Pos(T x, T y, T z) : x(x), y(y), z(z) {}
-        Pos(const Vector3& v) : x(v.x), y(v.y), z(v.z) {}
-        Pos(const Vector3i& v) : x(v.x), y(v.y), z(v.z) {}
+        template<VectorLike V>
+        Pos(const V& v) : x((T)v.x), y((T)v.y), z((T)v.z) {}
         template<typename T2>
         requires AbleToCast<T, T2>
         Pos(const Pos<T2>& pos) : x((T)pos.x), y((T)pos.y), z((T)pos.z) {}
@@ -50,11 +56,10 @@ export namespace craftbuild {
 
 #undef def_operator
 
-        operator godot::Vector3() const {
-            return godot::Vector3(static_cast<float32>(x), static_cast<float32>(y), static_cast<float32>(z));
-        }
-        operator godot::Vector3i() const {
-            return godot::Vector3i(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z));
+        template<VectorLike V>
+        operator V() const {
+            using U = std::remove_cvref_t<decltype(std::declval<V>().x)>;
+            return V(static_cast<U>(x), static_cast<U>(y), static_cast<U>(z));
         }
 
         bool operator==(const Pos& other) const {
@@ -65,8 +70,16 @@ export namespace craftbuild {
     template <typename T>
     requires std::is_arithmetic_v<T>
     struct Hasher<Pos<T>> {
+        // For Dict keys (pending writes, tickets, the write-behind queue) and ChunkScheduler's queued set. Combines the
+        // components and runs a splitmix64 finaliser, so the bucket those std containers pick depends on all of them.
         size operator()(const Pos<T>& pos) const {
-            return std::hash<T>{}(pos.x) ^ (std::hash<T>{}(pos.y) << 16) ^ (std::hash<T>{}(pos.z) << 8);
+            uint64 h = 0;
+            for (const T& component : { pos.x, pos.y, pos.z }) {
+                h ^= static_cast<uint64>(std::hash<T>{}(component)) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            }
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+            return static_cast<size>(h ^ (h >> 31));
         }
     };
 }
\ No newline at end of file
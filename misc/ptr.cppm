@@ -2,6 +2,7 @@ module;
 
 #include <includes.hpp>
 #include <atomic>
+#include <cstddef>
 
 export module misc.ptr;
 
@@ -28,7 +29,7 @@ export namespace craftbuild {
 	public:
 		Ptr() : __value__(nullptr), __rc__(nullptr) {}
 		Ptr(T* x) : __value__(x) { init(); }
-		Ptr(const Ptr<T>& x) : __value__(x.__value__), __rc__(x.__rc__) { retain(); }
+		Ptr(const Ptr<T>& x) noexcept : __value__(x.__value__), __rc__(x.__rc__) { retain(); }
 		Ptr(Ptr<T>&& x) noexcept : __value__(x.__value__), __rc__(x.__rc__) {
 			x.__value__ = nullptr;
 			x.__rc__ = nullptr;
@@ -73,7 +74,9 @@ export namespace craftbuild {
 			if (not __rc__) return;
 
 			if (__rc__->fetch_sub(1, std::memory_order_acq_rel) == 1) {
-				delete __value__;
+				// Types that pool their objects take them back instead
+				if constexpr (requires { T::recycle(__value__); }) T::recycle(__value__);
+				else delete __value__;
 				delete __rc__;
 			}
 
@@ -124,4 +127,127 @@ export namespace craftbuild {
 			return fm;
 		}
 	};
-}
\ No newline at end of file
+
+	// Borrowed access for hot paths that would otherwise copy an owning pointer; making or copying one touches
+	// no counter. Whatever hands out a View says what keeps the object alive while it is used.
+	template <typename T>
+	class View {
+		T* __value__ = nullptr;
+
+	public:
+		View() = default;
+		View(std::nullptr_t) {}
+		View(T* x) : __value__(x) {}
+		View(T& x) : __value__(&x) {}
+
+		explicit operator bool() const { return __value__ != nullptr; }
+
+		inline T& value() const {
+			if (__value__) return *__value__;
+			throw std::runtime_error("Cannot access nullptr of view");
+		}
+
+		inline T* c_ptr() const noexcept {
+			return __value__;
+		}
+	};
+
+	// Base for objects shared through IPtr. The count lives in the object, so owning one takes a single
+	// allocation and a copy touches the object's own cache line. Copying the object does not copy its count.
+	class RefCounted {
+		mutable std::atomic<size> __refs__ = 0;
+
+		template <typename T>
+		friend class IPtr;
+
+	public:
+		RefCounted() = default;
+		RefCounted(const RefCounted&) noexcept {}
+		RefCounted& operator=(const RefCounted&) noexcept { return *this; }
+	};
+
+	// Ptr for types that derive from RefCounted. As the count is intrusive, an IPtr can be made from a raw
+	// pointer or a View whenever something else is known to keep the object alive.
+	template <typename T>
+	class IPtr {
+		T* __value__ = nullptr;
+
+		inline none retain() noexcept {
+			static_assert(std::is_base_of_v<RefCounted, T>, "IPtr needs a type derived from RefCounted");
+			if (__value__) static_cast<const RefCounted*>(__value__)->__refs__.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	public:
+		IPtr() = default;
+		IPtr(T* x) : __value__(x) { retain(); }
+		IPtr(View<T> x) : __value__(x.c_ptr()) { retain(); }
+		IPtr(const IPtr<T>& x) noexcept : __value__(x.__value__) { retain(); }
+		IPtr(IPtr<T>&& x) noexcept : __value__(x.__value__) {
+			x.__value__ = nullptr;
+		}
+		~IPtr() { clear(); }
+
+		IPtr<T>& operator=(T* x) {
+			if (x == __value__) return *this;
+
+			clear();
+			__value__ = x;
+			retain();
+
+			return *this;
+		}
+		IPtr<T>& operator=(const IPtr<T>& x) {
+			return *this = x.__value__;
+		}
+		IPtr<T>& operator=(IPtr<T>&& x) noexcept {
+			if (this == &x) return *this;
+
+			clear();
+			__value__ = x.__value__;
+			x.__value__ = nullptr;
+
+			return *this;
+		}
+
+		explicit operator bool() const { return __value__ != nullptr; }
+
+		none clear() {
+			if (not __value__) return;
+
+			T* value = __value__;
+			__value__ = nullptr;
+			if (static_cast<const RefCounted*>(value)->__refs__.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				// Types that pool their objects take them back instead
+				if constexpr (requires { T::recycle(value); }) T::recycle(value);
+				else delete value;
+			}
+		}
+
+		inline T& value() const {
+			if (__value__) return *__value__;
+			throw std::runtime_error("Cannot access nullptr of ptr");
+		}
+
+		inline std::size_t get_count() const noexcept {
+			return __value__ ? static_cast<const RefCounted*>(__value__)->__refs__.load(std::memory_order_relaxed) : 0;
+		}
+
+		inline std::string address() const {
+			return format{} << __value__;
+		}
+
+		inline View<T> view() const noexcept {
+			return View<T>(__value__);
+		}
+
+		// DANGER ZONE
+		inline T* c_ptr() const noexcept {
+			return __value__;
+		}
+
+		friend format&& operator<<(format&& fm, const IPtr<T>& d) {
+			std::move(fm) << d.value();
+			return fm;
+		}
+	};
+}
@@ -0,0 +1,276 @@
+#include <includes.hpp>
+
+#include <map>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+import misc.pos;
+import misc.range;
+import misc.number;
+import game.core;
+import game.world.chunk;
+import game.world.pregen;
+import game.world.content;
+
+using namespace craftbuild;
+
+// Generates a fixed set of chunks for a few seeds at several thread counts, reports throughput and
+// per-stage time, and checks the content hash of every chunk against tools/bench/golden_hashes.txt.
+// It also unloads the unmodified chunks and generates them again, which must change nothing.
+// Any change to the generated terrain fails the run until the goldens are re-blessed with --bless.
+namespace {
+    constexpr int32 SEEDS[] = { 0, 1, 1337, -424242, 20240917 };
+
+    struct Area {
+        int32 center_x;
+        int32 center_z;
+        int32 radius;
+    };
+
+    // Spawn plus a far area, where float precision problems in the noise would show up first.
+    constexpr Area AREAS[] = {
+        { 0, 0, 3 },
+        { -2000, 1500, 1 },
+    };
+
+    using GoldenKey = std::tuple<int32, int32, int32>;
+    using Goldens = std::map<GoldenKey, uint64>;
+
+    std::vector<Pos<int32>> bench_targets() {
+        std::vector<Pos<int32>> targets;
+        for (const auto& area : AREAS) {
+            for (auto x : range<int32>(-area.radius, area.radius + 1)) {
+                for (auto z : range<int32>(-area.radius, area.radius + 1)) {
+                    targets.emplace_back(area.center_x + x, 0, area.center_z + z);
+                }
+            }
+        }
+        return targets;
+    }
+
+    bool load_goldens(const std::string& path, Goldens& goldens) {
+        std::ifstream ifs(path);
+        if (not ifs.is_open()) return false;
+
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.empty() or line[0] == '#') continue;
+
+            std::istringstream row(line);
+            int32 seed, x, z;
+            uint64 hash;
+            if (row >> seed >> x >> z >> std::hex >> hash) goldens[{ seed, x, z }] = hash;
+        }
+        return true;
+    }
+
+    bool save_goldens(const std::string& path, const Goldens& goldens) {
+        std::ofstream ofs(path, std::ios::trunc);
+        if (not ofs.is_open()) return false;
+
+        ofs << "# seed chunk_x chunk_z content_hash\n";
+        ofs << "# Regenerate with: craftbuild_bench --bless (only when a terrain change is intended)\n";
+        for (const auto& [key, hash] : goldens) {
+            const auto& [seed, x, z] = key;
+            char buffer[96];
+            std::snprintf(buffer, sizeof(buffer), "%d %d %d %016llx\n", seed, x, z, static_cast<unsigned long long>(hash));
+            ofs << buffer;
+        }
+        return static_cast<bool>(ofs);
+    }
+
+    std::vector<size> default_thread_counts() {
+        const size hardware = std::max<size>(std::thread::hardware_concurrency(), 1);
+        std::vector<size> counts;
+        for (size n = 1; n < hardware; n *= 2) counts.push_back(n);
+        counts.push_back(hardware);
+        return counts;
+    }
+
+    std::vector<size> parse_thread_counts(const std::string& list) {
+        std::vector<size> counts;
+        std::istringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) counts.push_back(static_cast<size>(std::stoul(item)));
+        return counts;
+    }
+
+    none print_usage() {
+        std::printf(
+            "usage: craftbuild_bench [options]\n"
+            "  --threads <a,b,...>   thread counts to run (default 1, 2, 4, ... up to every hardware thread)\n"
+            "  --repeat <n>          repetitions per thread count, the fastest is reported (default 3)\n"
+            "  --golden <file>       golden hash file (default tools/bench/golden_hashes.txt)\n"
+            "  --bless               write the current hashes to the golden file instead of checking\n"
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    craftbuild_debug = false;
+
+    std::vector<size> thread_counts = default_thread_counts();
+    std::string golden_path = "tools/bench/golden_hashes.txt";
+    int32 repeat = 3;
+    bool bless = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            auto next = [&]() -> const char* {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(arg) + " needs a value");
+                return argv[++i];
+            };
+
+            if (arg == "--threads")     thread_counts = parse_thread_counts(next());
+            else if (arg == "--repeat") repeat = std::max(std::stoi(next()), 1);
+            else if (arg == "--golden") golden_path = next();
+            else if (arg == "--bless")  bless = true;
+            else throw std::invalid_argument("unknown option " + std::string(arg));
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        print_usage();
+        return 1;
+    }
+
+    register_world_content();
+
+    const auto targets = bench_targets();
+    const size chunks_per_run = targets.size() * std::size(SEEDS);
+
+    Goldens goldens;
+    if (not bless and not load_goldens(golden_path, goldens)) {
+        std::fprintf(stderr, "error: cannot read %s (run with --bless to create it)\n", golden_path.c_str());
+        return 1;
+    }
+
+    std::printf("%zu chunks per run (%zu seeds x %zu chunks), best of %d\n\n", chunks_per_run, std::size(SEEDS), targets.size(), repeat);
+    std::printf("threads   chunks/s   terrain ms   features ms   commit ms   merge ms\n");
+
+    Goldens observed;
+    size mismatches = 0;
+    size missing = 0;
+
+    for (const size threads : thread_counts) {
+        float64 best_seconds = 0.0;
+        GenerationTimings best_timings;
+
+        for (auto attempt : range<int32>(repeat)) {
+            float64 seconds = 0.0;
+            GenerationTimings timings;
+
+            for (const int32 seed : SEEDS) {
+                PregenOptions options;
+                options.seed = seed;
+                options.threads = threads;
+
+                Pregenerator pregen(options);
+                pregen.load();
+                seconds += pregen.run(targets).seconds;
+                timings += pregen.get_timings();
+
+                for (const auto& pos : targets) {
+                    const uint64 hash = pregen.find_chunk(pos).value().content_hash();
+                    const GoldenKey key{ seed, pos.x, pos.z };
+
+                    auto [it, inserted] = observed.emplace(key, hash);
+                    if (not inserted and it->second != hash) {
+                        std::fprintf(stderr, "NONDETERMINISTIC seed %d chunk (%d, %d) at %zu threads: %016llx != %016llx\n",
+                            seed, pos.x, pos.z, threads, static_cast<unsigned long long>(hash), static_cast<unsigned long long>(it->second));
+                        ++mismatches;
+                    }
+                }
+            }
+
+            if (attempt == 0 or seconds < best_seconds) {
+                best_seconds = seconds;
+                best_timings = timings;
+            }
+        }
+
+        const float64 per_chunk = 1000.0 / static_cast<float64>(chunks_per_run);
+        std::printf("%7zu %10.1f %12.3f %13.3f %11.3f %10.3f\n",
+            threads,
+            best_seconds > 0.0 ? static_cast<float64>(chunks_per_run) / best_seconds : 0.0,
+            best_timings.terrain * per_chunk,
+            best_timings.features * per_chunk,
+            best_timings.commit * per_chunk,
+            best_timings.merge * per_chunk
+        );
+        std::fflush(stdout);
+    }
+
+    // Unloading and generating again must give the same world. Only chunks that neither took nor sent structure
+    // blocks are dropped, and generating those again must not send anything a second time.
+    size regenerated = 0;
+    for (const int32 seed : SEEDS) {
+        PregenOptions options;
+        options.seed = seed;
+
+        Pregenerator pregen(options);
+        pregen.load();
+        pregen.run(targets);
+        const size queued = pregen.pending_block_count();
+
+        for (const auto& pos : targets) {
+            if (pregen.unload(pos)) ++regenerated;
+        }
+        pregen.run(targets);
+
+        for (const auto& pos : targets) {
+            const uint64 hash = pregen.find_chunk(pos).value().content_hash();
+            const uint64 expected = observed[{ seed, pos.x, pos.z }];
+            if (hash != expected) {
+                std::fprintf(stderr, "REGENERATED seed %d chunk (%d, %d): %016llx != %016llx\n",
+                    seed, pos.x, pos.z, static_cast<unsigned long long>(hash), static_cast<unsigned long long>(expected));
+                ++mismatches;
+            }
+        }
+        if (pregen.pending_block_count() != queued) {
+            std::fprintf(stderr, "REGENERATED seed %d queued %zu structure blocks, %zu before\n", seed, pregen.pending_block_count(), queued);
+            ++mismatches;
+        }
+    }
+    std::printf("\nRegenerated %zu unmodified chunks\n", regenerated);
+
+    if (bless) {
+        if (not save_goldens(golden_path, observed)) {
+            std::fprintf(stderr, "error: cannot write %s\n", golden_path.c_str());
+            return 1;
+        }
+        std::printf("\nBlessed %zu hashes into %s\n", observed.size(), golden_path.c_str());
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    for (const auto& [key, hash] : observed) {
+        const auto& [seed, x, z] = key;
+        auto it = goldens.find(key);
+        if (it == goldens.end()) {
+            std::fprintf(stderr, "MISSING golden for seed %d chunk (%d, %d)\n", seed, x, z);
+            ++missing;
+        }
+        else if (it->second != hash) {
+            std::fprintf(stderr, "CHANGED seed %d chunk (%d, %d): %016llx, golden %016llx\n",
+                seed, x, z, static_cast<unsigned long long>(hash), static_cast<unsigned long long>(it->second));
+            ++mismatches;
+        }
+    }
+
+    if (mismatches != 0 or missing != 0) {
+        std::fprintf(stderr, "\nFAILED: %zu chunks differ, %zu have no golden hash\n", mismatches, missing);
+        return 1;
+    }
+
+    std::printf("\nAll %zu chunk hashes match the goldens\n", observed.size());
+    return 0;
+}
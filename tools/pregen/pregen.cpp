@@ -0,0 +1,86 @@
+#include <includes.hpp>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+import misc.number;
+import game.core;
+import game.world.pregen;
+import game.world.content;
+
+using namespace craftbuild;
+
+namespace {
+    none print_usage() {
+        std::printf(
+            "usage: craftbuild_pregen <save file> --radius <chunks> [options]\n"
+            "  --center <x> <z>   center chunk (default 0 0)\n"
+            "  --circle           generate a circle instead of a square\n"
+            "  --seed <seed>      seed for a new world (ignored when the save exists)\n"
+            "  --threads <n>      worker count (default: every hardware thread)\n"
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    craftbuild_debug = false;
+
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    PregenOptions options;
+    options.save_path = argv[1];
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            auto next = [&]() -> const char* {
+                if (i + 1 >= argc) throw std::invalid_argument(std::string(arg) + " needs a value");
+                return argv[++i];
+            };
+
+            if (arg == "--radius")       options.radius = std::stoi(next());
+            else if (arg == "--center") {
+                options.center_x = std::stoi(next());
+                options.center_z = std::stoi(next());
+            }
+            else if (arg == "--circle")  options.shape = PregenShape::CIRCLE;
+            else if (arg == "--seed")    options.seed = static_cast<int32>(std::stoll(next()));
+            else if (arg == "--threads") options.threads = static_cast<size>(std::stoul(next()));
+            else throw std::invalid_argument("unknown option " + std::string(arg));
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        print_usage();
+        return 1;
+    }
+
+    register_world_content();
+
+    Pregenerator pregen(options);
+    if (not pregen.load()) {
+        std::fprintf(stderr, "error: cannot read %s (open and save it once in game %s to upgrade it)\n", options.save_path.string().c_str(), version);
+        return 1;
+    }
+
+    std::printf("Pregenerating radius %d around chunk (%d, %d), seed %d\n", options.radius, options.center_x, options.center_z, pregen.get_seed());
+
+    const PregenProgress result = pregen.run([](const PregenProgress& progress) {
+        std::printf("  %zu/%zu chunks, %.1f chunks/s\n", progress.done, progress.total, progress.chunks_per_second());
+        std::fflush(stdout);
+    });
+
+    std::printf("Generated %zu chunks in %.2f s (%.1f chunks/s)\n", result.done, result.seconds, result.chunks_per_second());
+
+    if (not pregen.save()) {
+        std::fprintf(stderr, "error: cannot write %s\n", options.save_path.string().c_str());
+        return 1;
+    }
+
+    std::printf("Saved %zu chunks to %s\n", pregen.chunk_count(), options.save_path.string().c_str());
+    return 0;
+}